@@ -3,16 +3,44 @@
 
 #include <algorithm>
 #include <any>
+#include <atomic>
+#include <array>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <future>
 #include <initializer_list>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
 #include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define PELCOD_HAS_SSE2 1
+    #include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+    #define PELCOD_HAS_AVX2 1
+    #include <immintrin.h>
+#endif
+#if defined(__linux__)
+    #define PELCOD_HAS_CLOCK_NANOSLEEP 1
+    #include <cerrno>
+    #include <time.h>
+#endif
+
 /*!
 * c++17
 PELCO_D 协议
@@ -74,6 +102,1097 @@ union StandardCMD {
     _StandardCMD _cmd = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 };
 
+/*!
+ * 只读字节视图,c++17 下 std::span<const std::uint8_t> 的替代品.
+ * 不持有数据,调用方需保证视图生命周期内数据有效.
+ */
+class PelcoDByteView {
+public:
+    constexpr PelcoDByteView() = default;
+    constexpr PelcoDByteView(const std::uint8_t* data, std::size_t size)
+        : mData(data)
+        , mSize(size) {
+    }
+    PelcoDByteView(const std::byte* data, std::size_t size)
+        : mData(reinterpret_cast<const std::uint8_t*>(data))
+        , mSize(size) {
+    }
+    PelcoDByteView(const std::vector<std::uint8_t>& data)
+        : mData(data.data())
+        , mSize(data.size()) {
+    }
+    template <std::size_t N>
+    constexpr PelcoDByteView(const std::array<std::uint8_t, N>& data)
+        : mData(data.data())
+        , mSize(N) {
+    }
+
+    constexpr const std::uint8_t* data() const {
+        return mData;
+    }
+    constexpr std::size_t size() const {
+        return mSize;
+    }
+    constexpr bool empty() const {
+        return mSize == 0;
+    }
+    constexpr const std::uint8_t* begin() const {
+        return mData;
+    }
+    constexpr const std::uint8_t* end() const {
+        return mData + mSize;
+    }
+    constexpr std::uint8_t operator[](std::size_t index) const {
+        return mData[index];
+    }
+
+private:
+    const std::uint8_t* mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+/*!
+ * 命令字: 高字节为 Command 1,低字节为 Command 2.
+ * 标准命令的各个位与 _StandardCMD 位域一一对应,可以按位或组合,例如 Left | Up.
+ */
+enum class PelcoDCommand : std::uint16_t
+{
+    // 标准命令
+    Stop      = 0x0000,
+    Right     = 0x0002,
+    Left      = 0x0004,
+    Up        = 0x0008,
+    Down      = 0x0010,
+    ZoomTele  = 0x0020,
+    ZoomWide  = 0x0040,
+    FocusFar  = 0x0080,
+    FocusNear = 0x0100,
+    IrisOpen  = 0x0200,
+    IrisClose = 0x0400,
+    Camera    = 0x0800,
+    Scan      = 0x1000,
+    Sense     = 0x8000,
+
+    // 扩展命令
+    SetPreset                  = 0x0003,
+    ClearPreset                = 0x0005,
+    CallPreset                 = 0x0007,
+    SetPanPosition             = 0x004B,
+    SetTiltPosition            = 0x004D,
+    SetZoomPosition            = 0x004F,
+    QueryPanPosition           = 0x0051,
+    QueryTiltPosition          = 0x0053,
+    QueryZoomPosition          = 0x0055,
+    QueryPanPositionResponse   = 0x0059,
+    QueryTiltPositionResponse  = 0x005B,
+    QueryZoomPositionResponse  = 0x005D,
+    SetMagnification           = 0x005F,
+    QueryMagnification         = 0x0061,
+    QueryMagnificationResponse = 0x0063,
+};
+
+constexpr PelcoDCommand operator|(PelcoDCommand lhs, PelcoDCommand rhs) {
+    return PelcoDCommand(std::uint16_t(lhs) | std::uint16_t(rhs));
+}
+
+/*!
+ * 标准 Pelco-D 7 字节帧,栈上分配,组帧与发送均不申请堆内存.
+ * [0xff, address, cmd_1, cmd_2, data_1, data_2, checksum]
+ * 所有构造函数均为 constexpr,固定指令可以在编译期生成.
+ */
+struct PelcoDFrame {
+    static constexpr std::size_t kSize = 7;
+
+    constexpr PelcoDFrame() = default;
+    constexpr PelcoDFrame(std::uint8_t address, std::uint8_t cmd_1, std::uint8_t cmd_2, std::uint8_t data_1, std::uint8_t data_2)
+        : bytes{0xff, address, cmd_1, cmd_2, data_1, data_2, std::uint8_t(address + cmd_1 + cmd_2 + data_1 + data_2)} {
+    }
+    constexpr PelcoDFrame(std::uint8_t address, PelcoDCommand cmd, std::uint8_t data_1 = 0x00, std::uint8_t data_2 = 0x00)
+        : PelcoDFrame(address, std::uint8_t(std::uint16_t(cmd) >> 8), std::uint8_t(std::uint16_t(cmd) & 0xff), data_1, data_2) {
+    }
+
+    constexpr const std::uint8_t* data() const {
+        return bytes.data();
+    }
+    constexpr std::size_t size() const {
+        return kSize;
+    }
+    constexpr PelcoDByteView view() const {
+        return PelcoDByteView(bytes.data(), kSize);
+    }
+
+    std::array<std::uint8_t, kSize> bytes = {0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+};
+
+// 与地址以外参数无关的固定指令,可以整帧预先生成
+enum class PelcoDFixedCommand : std::uint8_t
+{
+    StopMotion,
+    FocusNear,
+    FocusFar,
+    ZoomIn,
+    ZoomOut,
+    IrisOpen,
+    IrisClose,
+    QueryPanPosition,
+    QueryTiltPosition,
+    QueryZoomPosition,
+    QueryMagnification,
+    Count
+};
+
+constexpr PelcoDCommand kPelcoDFixedCommands[] = {
+    PelcoDCommand::Stop,
+    PelcoDCommand::FocusNear,
+    PelcoDCommand::FocusFar,
+    PelcoDCommand::ZoomTele,
+    PelcoDCommand::ZoomWide,
+    PelcoDCommand::IrisOpen,
+    PelcoDCommand::IrisClose,
+    PelcoDCommand::QueryPanPosition,
+    PelcoDCommand::QueryTiltPosition,
+    PelcoDCommand::QueryZoomPosition,
+    PelcoDCommand::QueryMagnification,
+};
+
+using PelcoDFrameTable = std::array<std::array<PelcoDFrame, std::size_t(PelcoDFixedCommand::Count)>, 256>;
+
+constexpr PelcoDFrameTable makePelcoDFrameTable() {
+    PelcoDFrameTable table = {};
+    for (std::size_t address = 0; address < table.size(); ++address) {
+        for (std::size_t i = 0; i < table[address].size(); ++i) {
+            table[address][i] = PelcoDFrame(std::uint8_t(address), kPelcoDFixedCommands[i]);
+        }
+    }
+    return table;
+}
+
+// 全部 256 个地址的固定指令帧,编译期生成
+inline constexpr PelcoDFrameTable kPelcoDFrameTable = makePelcoDFrameTable();
+
+inline const PelcoDFrame& pelcoDFixedFrame(std::uint8_t address, PelcoDFixedCommand cmd) {
+    return kPelcoDFrameTable[address][std::size_t(cmd)];
+}
+
+static_assert(PelcoDFrame(0x01, PelcoDCommand::Left, 0x20).bytes[3] == 0x04 && PelcoDFrame(0x01, PelcoDCommand::Left, 0x20).bytes[6] == 0x25, "panLeft frame");
+static_assert(PelcoDFrame(0x01, PelcoDCommand::FocusNear).bytes[2] == 0x01 && PelcoDFrame(0x01, PelcoDCommand::FocusNear).bytes[6] == 0x02, "focusNear frame");
+static_assert(PelcoDFrame(0xff, PelcoDCommand::SetPanPosition, 0x8c, 0x9f).bytes[6] == 0x75, "checksum wraps modulo 0x100");
+static_assert(kPelcoDFrameTable[0x01][std::size_t(PelcoDFixedCommand::StopMotion)].bytes[6] == 0x01, "stopMotion frame");
+static_assert(kPelcoDFrameTable[0x10][std::size_t(PelcoDFixedCommand::QueryZoomPosition)].bytes[3] == 0x55 && kPelcoDFrameTable[0x10][std::size_t(PelcoDFixedCommand::QueryZoomPosition)].bytes[6] == 0x65, "queryZoomPosition frame");
+
+/*!
+ * 固定 _StandardCMD 的位序.
+ * StandardCMD 依赖编译器的位域布局,这里在编译期确认位域与 PelcoDCommand 的取值一致,
+ * 不一致(例如大端平台)时编译失败,而不是发出错误的指令.
+ */
+#if defined(__has_builtin)
+    #if __has_builtin(__builtin_bit_cast)
+        #define PELCOD_HAS_BUILTIN_BIT_CAST 1
+    #endif
+#elif defined(_MSC_VER) && _MSC_VER >= 1927
+    #define PELCOD_HAS_BUILTIN_BIT_CAST 1
+#endif
+
+#if defined(PELCOD_HAS_BUILTIN_BIT_CAST)
+constexpr std::uint16_t standardCommandWord(_StandardCMD bits) {
+    auto raw = __builtin_bit_cast(std::array<std::uint8_t, sizeof(_StandardCMD)>, bits);
+    return std::uint16_t(raw[0] << 8 | raw[1]);
+}
+
+static_assert(sizeof(StandardCMD_) == 2, "StandardCMD_ layout");
+static_assert(standardCommandWord(_StandardCMD{}) == std::uint16_t(PelcoDCommand::Stop), "_StandardCMD layout");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.focus_near = 1; return c; }()) == std::uint16_t(PelcoDCommand::FocusNear), "_StandardCMD::focus_near");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.iris_open = 1; return c; }()) == std::uint16_t(PelcoDCommand::IrisOpen), "_StandardCMD::iris_open");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.iris_close = 1; return c; }()) == std::uint16_t(PelcoDCommand::IrisClose), "_StandardCMD::iris_close");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.camera = 1; return c; }()) == std::uint16_t(PelcoDCommand::Camera), "_StandardCMD::camera");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.scan = 1; return c; }()) == std::uint16_t(PelcoDCommand::Scan), "_StandardCMD::scan");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.sense = 1; return c; }()) == std::uint16_t(PelcoDCommand::Sense), "_StandardCMD::sense");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.right = 1; return c; }()) == std::uint16_t(PelcoDCommand::Right), "_StandardCMD::right");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.left = 1; return c; }()) == std::uint16_t(PelcoDCommand::Left), "_StandardCMD::left");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.up = 1; return c; }()) == std::uint16_t(PelcoDCommand::Up), "_StandardCMD::up");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.down = 1; return c; }()) == std::uint16_t(PelcoDCommand::Down), "_StandardCMD::down");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.zoom_tele = 1; return c; }()) == std::uint16_t(PelcoDCommand::ZoomTele), "_StandardCMD::zoom_tele");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.zoom_wide = 1; return c; }()) == std::uint16_t(PelcoDCommand::ZoomWide), "_StandardCMD::zoom_wide");
+static_assert(standardCommandWord([] { _StandardCMD c{}; c.focus_far = 1; return c; }()) == std::uint16_t(PelcoDCommand::FocusFar), "_StandardCMD::focus_far");
+#endif
+
+/*!
+ * 只读帧视图,指向接收缓冲区或解析器内部缓存,仅在回调期间有效.
+ */
+class PelcoDFrameView {
+public:
+    explicit PelcoDFrameView(const std::uint8_t* data)
+        : mData(data) {
+    }
+
+    std::uint8_t address() const {
+        return mData[1];
+    }
+    std::uint8_t cmd_1() const {
+        return mData[2];
+    }
+    std::uint8_t cmd_2() const {
+        return mData[3];
+    }
+    std::uint8_t data_1() const {
+        return mData[4];
+    }
+    std::uint8_t data_2() const {
+        return mData[5];
+    }
+    PelcoDCommand command() const {
+        return PelcoDCommand(mData[2] << 8 | mData[3]);
+    }
+    // data_1 为高字节的 16 位数据,例如查询响应中的位置
+    std::uint16_t value() const {
+        return std::uint16_t(mData[4] << 8 | mData[5]);
+    }
+    const std::uint8_t* data() const {
+        return mData;
+    }
+    PelcoDByteView view() const {
+        return PelcoDByteView(mData, PelcoDFrame::kSize);
+    }
+
+private:
+    const std::uint8_t* mData;
+};
+
+struct PelcoDParserStats {
+    std::uint64_t frames = 0;        // 解析出的合法帧
+    std::uint64_t resyncs = 0;       // 丢弃字节重新寻找同步字节的次数
+    std::uint64_t badChecksums = 0;  // 以 0xff 开头但校验失败的帧
+    std::uint64_t discardedBytes = 0;// 丢弃的字节数
+};
+
+/*!
+ * 增量式接收解析器,每个串口/连接一个实例.
+ * feed() 接受任意切分的字节片段,完整落在片段内的帧直接以视图形式回调,不做拷贝;
+ * 只有跨片段的帧会暂存在内部 7 字节缓存中.
+ * 遇到垃圾数据或校验失败时从失败位置的下一个字节开始寻找 0xff 重新同步.
+ */
+class PelcoDFrameParser {
+public:
+    template <typename Handler>
+    void feed(PelcoDByteView data, Handler&& handler) {
+        feed(data.data(), data.size(), std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    void feed(const std::uint8_t* data, std::size_t size, Handler&& handler) {
+        std::size_t i = 0;
+        // 先补齐上次残留的半帧
+        while (mPartialSize > 0 && i < size) {
+            auto take = std::min(PelcoDFrame::kSize - mPartialSize, size - i);
+            std::memcpy(mPartial.data() + mPartialSize, data + i, take);
+            mPartialSize += take;
+            i += take;
+            if (mPartialSize < PelcoDFrame::kSize) {
+                return;
+            }
+            if (checkFrame(mPartial.data())) {
+                mPartialSize = 0;
+                handler(PelcoDFrameView(mPartial.data()));
+                continue;
+            }
+            // 在残留数据中寻找下一个同步字节
+            auto next = std::find(mPartial.begin() + 1, mPartial.end(), std::uint8_t(0xff));
+            auto skipped = std::size_t(next - mPartial.begin());
+            discard(skipped);
+            mPartialSize -= skipped;
+            std::memmove(mPartial.data(), mPartial.data() + skipped, mPartialSize);
+        }
+        while (i < size) {
+            if (data[i] != 0xff) {
+                auto next = static_cast<const std::uint8_t*>(std::memchr(data + i, 0xff, size - i));
+                auto skipped = next ? std::size_t(next - (data + i)) : size - i;
+                discard(skipped);
+                i += skipped;
+                continue;
+            }
+            if (size - i < PelcoDFrame::kSize) {
+                mPartialSize = size - i;
+                std::memcpy(mPartial.data(), data + i, mPartialSize);
+                return;
+            }
+            if (checkFrame(data + i)) {
+                handler(PelcoDFrameView(data + i));
+                i += PelcoDFrame::kSize;
+            } else {
+                discard(1);
+                ++i;
+            }
+        }
+    }
+
+    const PelcoDParserStats& stats() const {
+        return mStats;
+    }
+    void reset() {
+        mPartialSize = 0;
+        mSynced = true;
+        mStats = PelcoDParserStats();
+    }
+
+private:
+    bool checkFrame(const std::uint8_t* p) {
+        if (std::uint8_t(p[1] + p[2] + p[3] + p[4] + p[5]) != p[6]) {
+            ++mStats.badChecksums;
+            return false;
+        }
+        ++mStats.frames;
+        mSynced = true;
+        return true;
+    }
+    void discard(std::size_t bytes) {
+        if (bytes == 0) {
+            return;
+        }
+        if (mSynced) {
+            ++mStats.resyncs;
+            mSynced = false;
+        }
+        mStats.discardedBytes += bytes;
+    }
+
+private:
+    std::array<std::uint8_t, PelcoDFrame::kSize> mPartial = {};
+    std::size_t mPartialSize = 0;
+    bool mSynced = true;
+    PelcoDParserStats mStats;
+};
+
+// 查询类型
+enum class PelcoDQuery : std::uint8_t
+{
+    Pan,
+    Tilt,
+    Zoom,
+    Magnification,
+    Count
+};
+
+inline PelcoDCommand pelcoDQueryCommand(PelcoDQuery query) {
+    constexpr PelcoDCommand commands[] = {PelcoDCommand::QueryPanPosition, PelcoDCommand::QueryTiltPosition, PelcoDCommand::QueryZoomPosition, PelcoDCommand::QueryMagnification};
+    return commands[std::size_t(query)];
+}
+
+// 响应命令字 0x59/0x5B/0x5D/0x63 对应的查询类型,非响应帧返回 false
+inline bool pelcoDQueryFromResponse(PelcoDCommand cmd, PelcoDQuery& query) {
+    switch (cmd) {
+    case PelcoDCommand::QueryPanPositionResponse: query = PelcoDQuery::Pan; return true;
+    case PelcoDCommand::QueryTiltPositionResponse: query = PelcoDQuery::Tilt; return true;
+    case PelcoDCommand::QueryZoomPositionResponse: query = PelcoDQuery::Zoom; return true;
+    case PelcoDCommand::QueryMagnificationResponse: query = PelcoDQuery::Magnification; return true;
+    default: return false;
+    }
+}
+
+// 指令会改变哪些轴的位置,第 n 位对应 PelcoDQuery(n)
+constexpr std::uint8_t pelcoDMovedAxes(PelcoDCommand cmd) {
+    constexpr std::uint8_t pan = 1u << std::size_t(PelcoDQuery::Pan);
+    constexpr std::uint8_t tilt = 1u << std::size_t(PelcoDQuery::Tilt);
+    constexpr std::uint8_t zoom = 1u << std::size_t(PelcoDQuery::Zoom);
+    switch (cmd) {
+    case PelcoDCommand::SetPanPosition: return pan;
+    case PelcoDCommand::SetTiltPosition: return tilt;
+    case PelcoDCommand::SetZoomPosition:
+    case PelcoDCommand::SetMagnification: return zoom;
+    case PelcoDCommand::CallPreset: return pan | tilt | zoom;
+    default: break;
+    }
+    auto word = std::uint16_t(cmd);
+    // 扩展命令的 Command 2 最低位为 1,其余为标准命令
+    if (word & 0x0001) {
+        return 0;
+    }
+    return std::uint8_t((word & std::uint16_t(PelcoDCommand::Left | PelcoDCommand::Right) ? pan : 0)
+                        | (word & std::uint16_t(PelcoDCommand::Up | PelcoDCommand::Down) ? tilt : 0)
+                        | (word & std::uint16_t(PelcoDCommand::ZoomTele | PelcoDCommand::ZoomWide) ? zoom : 0));
+}
+
+static_assert(pelcoDMovedAxes(PelcoDCommand::Left | PelcoDCommand::Up) == 0x03, "pan and tilt move");
+static_assert(pelcoDMovedAxes(PelcoDCommand::QueryPanPosition) == 0x00, "queries do not move");
+
+// 单个设备的查询响应延迟统计
+struct PelcoDLatencyStats {
+    std::uint64_t responses = 0;
+    std::uint64_t timeouts = 0;
+    std::uint64_t retries = 0;
+    std::chrono::nanoseconds last{0};
+    std::chrono::nanoseconds min{std::chrono::nanoseconds::max()};
+    std::chrono::nanoseconds max{0};
+    std::chrono::nanoseconds total{0};
+
+    std::chrono::nanoseconds average() const {
+        return responses ? total / std::int64_t(responses) : std::chrono::nanoseconds(0);
+    }
+};
+
+/*!
+ * 查询/响应关联表.
+ * 以 (address, query) 为键登记未完成的查询,响应到达时解码完整的 16 位数据并完成回调或 future.
+ * 同一键已有未完成查询时新的请求合并等待,不会重复发送.
+ * 超时后按设置的次数重发,仍无响应则以失败结束;超时检查由 poll() 驱动.
+ * 线程安全,回调在锁外执行.
+ */
+class PelcoDQueryTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+    // ok 为 false 表示超时
+    using Callback = std::function<void(bool ok, std::uint16_t value)>;
+    // 发送(或重发)一次查询
+    using Sender = std::function<void(std::uint8_t address, PelcoDQuery query)>;
+
+    explicit PelcoDQueryTracker(Sender sender = nullptr)
+        : mSender(std::move(sender)) {
+    }
+
+    void setSender(Sender sender) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSender = std::move(sender);
+    }
+    // 单次等待时间,默认 200 毫秒
+    void setTimeout(std::chrono::milliseconds timeout) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTimeout = timeout;
+    }
+    // 超时后的重发次数,默认 2 次
+    void setRetries(std::uint32_t retries) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRetries = retries;
+    }
+
+    void submit(std::uint8_t address, PelcoDQuery query, Callback callback) {
+        Sender sender;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto& pending = mPending[key(address, query)];
+            pending.callbacks.push_back(std::move(callback));
+            if (pending.callbacks.size() > 1) {
+                return;
+            }
+            pending.sent = Clock::now();
+            pending.attempts = 1;
+            sender = mSender;
+        }
+        if (!sender) {
+            return;
+        }
+        try {
+            sender(address, query);
+        } catch (...) {
+            std::vector<Callback> joined;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                auto it = mPending.find(key(address, query));
+                if (it != mPending.end()) {
+                    joined = std::move(it->second.callbacks);
+                    mPending.erase(it);
+                }
+            }
+            // 发送期间合并进来的其他调用者按失败结束,本次调用者的回调随异常放弃
+            for (std::size_t i = 1; i < joined.size(); ++i) {
+                joined[i](false, 0);
+            }
+            throw;
+        }
+    }
+    std::future<std::uint16_t> submit(std::uint8_t address, PelcoDQuery query) {
+        auto promise = std::make_shared<std::promise<std::uint16_t>>();
+        auto future = promise->get_future();
+        submit(address, query, [promise](bool ok, std::uint16_t value) {
+            if (ok) {
+                promise->set_value(value);
+            } else {
+                promise->set_exception(std::make_exception_ptr(std::runtime_error("pelco-d query timeout")));
+            }
+        });
+        return future;
+    }
+
+    // 收到响应,返回是否匹配到未完成的查询
+    bool complete(std::uint8_t address, PelcoDQuery query, std::uint16_t value, Clock::time_point now = Clock::now()) {
+        std::vector<Callback> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mPending.find(key(address, query));
+            if (it == mPending.end()) {
+                return false;
+            }
+            auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - it->second.sent);
+            auto& stats = mLatency[address];
+            ++stats.responses;
+            stats.last = latency;
+            stats.min = std::min(stats.min, latency);
+            stats.max = std::max(stats.max, latency);
+            stats.total += latency;
+            callbacks = std::move(it->second.callbacks);
+            mPending.erase(it);
+        }
+        for (auto& callback : callbacks) {
+            callback(true, value);
+        }
+        return true;
+    }
+
+    // 处理超时与重发,返回下一个截止时间,没有未完成的查询时返回 time_point::max()
+    Clock::time_point poll(Clock::time_point now = Clock::now()) {
+        std::vector<std::pair<std::uint8_t, PelcoDQuery>> resend;
+        std::vector<Callback> expired;
+        Sender sender;
+        auto next = Clock::time_point::max();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (auto it = mPending.begin(); it != mPending.end();) {
+                auto& pending = it->second;
+                auto address = std::uint8_t(it->first >> 8);
+                if (now < pending.sent + mTimeout) {
+                    next = std::min(next, pending.sent + mTimeout);
+                    ++it;
+                } else if (pending.attempts <= mRetries && mSender) {
+                    ++pending.attempts;
+                    ++mLatency[address].retries;
+                    pending.sent = now;
+                    next = std::min(next, now + mTimeout);
+                    resend.emplace_back(address, PelcoDQuery(it->first & 0xff));
+                    ++it;
+                } else {
+                    ++mLatency[address].timeouts;
+                    std::move(pending.callbacks.begin(), pending.callbacks.end(), std::back_inserter(expired));
+                    it = mPending.erase(it);
+                }
+            }
+            sender = mSender;
+        }
+        for (auto& item : resend) {
+            sender(item.first, item.second);
+        }
+        for (auto& callback : expired) {
+            callback(false, 0);
+        }
+        return next;
+    }
+
+    // 最早的超时时刻,没有未完成的查询时返回 time_point::max();供外部定时器安排下一次 poll()
+    Clock::time_point nextDeadline() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto next = Clock::time_point::max();
+        for (const auto& item : mPending) {
+            next = std::min(next, item.second.sent + mTimeout);
+        }
+        return next;
+    }
+    bool isPending(std::uint8_t address, PelcoDQuery query) const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mPending.count(key(address, query)) != 0;
+    }
+    std::size_t pending() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mPending.size();
+    }
+    PelcoDLatencyStats latency(std::uint8_t address) const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mLatency.find(address);
+        return it == mLatency.end() ? PelcoDLatencyStats() : it->second;
+    }
+
+private:
+    struct Pending {
+        Clock::time_point sent;
+        std::uint32_t attempts = 0;
+        std::vector<Callback> callbacks;
+    };
+
+    static std::uint16_t key(std::uint8_t address, PelcoDQuery query) {
+        return std::uint16_t(address << 8 | std::uint8_t(query));
+    }
+
+private:
+    mutable std::mutex mMutex;
+    Sender mSender;
+    std::chrono::milliseconds mTimeout{200};
+    std::uint32_t mRetries = 2;
+    std::unordered_map<std::uint16_t, Pending> mPending;
+    std::unordered_map<std::uint8_t, PelcoDLatencyStats> mLatency;
+};
+
+/*!
+ * 一台设备的 pan/tilt/zoom 原始位置数据,与 setPanPosition/setTiltPosition/setZoomPosition 的 16 位参数一致.
+ */
+struct PelcoDPosition {
+    std::uint16_t pan = 0; // 0~35999, 百分之一度
+    std::uint16_t tilt = 0;// 0~9000 水平向下, 27000~35999 水平向上
+    std::uint16_t zoom = 0;// 0~65535
+
+    // 0.0 ~ 360.0
+    float panDegrees() const {
+        return pan / 100.f;
+    }
+    // -90.0 ~ 90.0, 正值为水平线以上
+    float tiltDegrees() const {
+        return tilt <= 18000 ? tilt / -100.f : (36000 - tilt) / 100.f;
+    }
+    // 0.0 ~ 1.0
+    float zoomRatio() const {
+        return zoom / 65535.f;
+    }
+    std::tuple<bool, float, float, float> ptz() const {
+        return std::make_tuple(true, panDegrees(), tiltDegrees(), zoomRatio());
+    }
+};
+
+/*!
+ * 单台设备的 PTZ 状态缓存,由解码后的位置响应填充,每个轴单独记录更新时间.
+ * 读取无锁(seqlock),供多个线程高频读取;写入由接收线程完成.
+ */
+class PelcoDStateCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 超过该时长的数据视为过期,默认 100 毫秒
+    void setStaleness(std::chrono::nanoseconds staleness) {
+        mStaleness.store(staleness.count(), std::memory_order_relaxed);
+    }
+    std::chrono::nanoseconds staleness() const {
+        return std::chrono::nanoseconds(mStaleness.load(std::memory_order_relaxed));
+    }
+
+    void update(PelcoDQuery axis, std::uint16_t value, Clock::time_point now = Clock::now()) {
+        if (std::size_t(axis) >= kAxes) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mWriteMutex);
+        mSeq.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        mValue[std::size_t(axis)].store(value, std::memory_order_relaxed);
+        mStamp[std::size_t(axis)].store(now.time_since_epoch().count(), std::memory_order_relaxed);
+        mSeq.fetch_add(1, std::memory_order_release);
+    }
+    // 设备开始运动后已缓存的位置不再可信
+    void invalidate(PelcoDQuery axis) {
+        invalidate(std::uint8_t(1u << std::size_t(axis)));
+    }
+    // axes 为按 PelcoDQuery 编号的位掩码(见 pelcoDMovedAxes);各轴都已失效时不加锁直接返回
+    void invalidate(std::uint8_t axes) {
+        std::uint8_t pending = 0;
+        for (std::size_t i = 0; i < kAxes; ++i) {
+            if ((axes & (1u << i)) && mStamp[i].load(std::memory_order_relaxed) != 0) {
+                pending |= std::uint8_t(1u << i);
+            }
+        }
+        if (pending == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mWriteMutex);
+        mSeq.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < kAxes; ++i) {
+            if (pending & (1u << i)) {
+                mValue[i].store(0, std::memory_order_relaxed);
+                mStamp[i].store(0, std::memory_order_relaxed);
+            }
+        }
+        mSeq.fetch_add(1, std::memory_order_release);
+    }
+
+    // 单个轴的更新时间,从未更新或已失效时为 time_point()
+    Clock::time_point stamp(PelcoDQuery axis) const {
+        return Clock::time_point(Clock::duration(mStamp[std::size_t(axis)].load(std::memory_order_acquire)));
+    }
+
+    // 读取缓存,oldest 为三个轴中最早的更新时间,从未更新的轴为 time_point()
+    void get(PelcoDPosition& position, Clock::time_point& oldest) const {
+        std::uint16_t value[kAxes];
+        Clock::rep stamp[kAxes];
+        std::uint32_t seq;
+        do {
+            seq = mSeq.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < kAxes; ++i) {
+                value[i] = mValue[i].load(std::memory_order_relaxed);
+                stamp[i] = mStamp[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) != 0 || seq != mSeq.load(std::memory_order_relaxed));
+        position.pan = value[0];
+        position.tilt = value[1];
+        position.zoom = value[2];
+        oldest = Clock::time_point(Clock::duration(*std::min_element(stamp, stamp + kAxes)));
+    }
+    // 三个轴均在有效期内时返回 true
+    bool fresh(PelcoDPosition& position, Clock::time_point now = Clock::now()) const {
+        Clock::time_point oldest;
+        get(position, oldest);
+        return oldest != Clock::time_point() && now - oldest <= staleness();
+    }
+
+private:
+    static constexpr std::size_t kAxes = 3;// pan/tilt/zoom
+
+    std::atomic<std::uint32_t> mSeq{0};
+    std::atomic<std::uint16_t> mValue[kAxes] = {};
+    std::atomic<Clock::rep> mStamp[kAxes] = {};
+    std::atomic<std::chrono::nanoseconds::rep> mStaleness{std::chrono::nanoseconds(std::chrono::milliseconds(100)).count()};
+    std::mutex mWriteMutex;
+};
+
+/*!
+ * 机型运动参数:速度字节 0x00~0x3f 对应的每秒转动角度.
+ */
+struct PelcoDMotionModel {
+    std::array<float, 0x40> panDegreesPerSecond = {};
+    std::array<float, 0x40> tiltDegreesPerSecond = {};
+
+    // 速度与速度字节成线性关系的机型
+    static PelcoDMotionModel linear(float maxPanDegreesPerSecond, float maxTiltDegreesPerSecond) {
+        PelcoDMotionModel model;
+        for (std::size_t speed = 0; speed < 0x40; ++speed) {
+            model.panDegreesPerSecond[speed] = maxPanDegreesPerSecond * speed / 0x3f;
+            model.tiltDegreesPerSecond[speed] = maxTiltDegreesPerSecond * speed / 0x3f;
+        }
+        return model;
+    }
+};
+
+/*!
+ * 航位推算:根据已发出的运动指令与速度表积分估算 pan/tilt,收到 0x59/0x5B 实测位置时校正.
+ * 距最近一次实测超过 horizon 后不再给出估算,由调用方重新查询,
+ * 以此在总线繁忙时把位置查询降低一个数量级.
+ * Pelco-D 标准命令完整描述运动状态,不含某方向位的标准命令即表示该方向停止.
+ */
+class PelcoDMotionEstimator {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PelcoDMotionEstimator(const PelcoDMotionModel& model = PelcoDMotionModel::linear(100.f, 60.f))
+        : mModel(model) {
+    }
+
+    void setModel(const PelcoDMotionModel& model) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mModel = model;
+    }
+    // 实测位置的最长可信推算时长,默认 1 秒
+    void setHorizon(std::chrono::nanoseconds horizon) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mHorizon = horizon;
+    }
+
+    // 指令发出后调用;不影响运动状态的指令不加锁也不读取时钟
+    void command(PelcoDCommand cmd, std::uint8_t data_1, std::uint8_t data_2) {
+        if (affectsMotion(cmd)) {
+            command(cmd, data_1, data_2, cmd == PelcoDCommand::CallPreset ? Clock::time_point() : Clock::now());
+        }
+    }
+    void command(PelcoDCommand cmd, std::uint8_t data_1, std::uint8_t data_2, Clock::time_point now) {
+        if (!affectsMotion(cmd)) {
+            return;
+        }
+        auto word = std::uint16_t(cmd);
+        std::lock_guard<std::mutex> lock(mMutex);
+        switch (cmd) {
+        case PelcoDCommand::SetPanPosition: mPan.moveTo(std::uint16_t(data_1 << 8 | data_2) / 100.f, now); return;
+        case PelcoDCommand::SetTiltPosition: mTilt.moveTo(PelcoDPosition{0, std::uint16_t(data_1 << 8 | data_2), 0}.tiltDegrees(), now); return;
+        // 到达时刻未知,不需要时间
+        case PelcoDCommand::CallPreset:
+            mPan.fixed = false;
+            mTilt.fixed = false;
+            return;
+        default: break;
+        }
+        float pan = mModel.panDegreesPerSecond[std::min<std::uint8_t>(data_1, 0x3f)];
+        float tilt = mModel.tiltDegreesPerSecond[std::min<std::uint8_t>(data_2, 0x3f)];
+        mPan.setVelocity((word & std::uint16_t(PelcoDCommand::Right)) ? pan : (word & std::uint16_t(PelcoDCommand::Left)) ? -pan : 0.f, now);
+        mTilt.setVelocity((word & std::uint16_t(PelcoDCommand::Up)) ? tilt : (word & std::uint16_t(PelcoDCommand::Down)) ? -tilt : 0.f, now);
+    }
+
+    // 实测位置校正
+    void correct(PelcoDQuery axis, std::uint16_t value, Clock::time_point now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (axis == PelcoDQuery::Pan) {
+            mPan.fix(value / 100.f, now);
+        } else if (axis == PelcoDQuery::Tilt) {
+            mTilt.fix(PelcoDPosition{0, value, 0}.tiltDegrees(), now);
+        }
+    }
+
+    // 估算当前角度,pan 0.0~360.0,tilt -90.0~90.0;没有可信的实测位置时返回 false
+    bool estimate(float& pan, float& tilt, Clock::time_point now = Clock::now()) const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mPan.usable(now, mHorizon) || !mTilt.usable(now, mHorizon)) {
+            return false;
+        }
+        pan = std::fmod(mPan.at(now), 360.f);
+        if (pan < 0.f) {
+            pan += 360.f;
+        }
+        tilt = std::clamp(mTilt.at(now), -90.f, 90.f);
+        return true;
+    }
+
+private:
+    struct Axis {
+        bool fixed = false;
+        float angle = 0.f;   // t0 时刻的角度
+        float velocity = 0.f;// 度/秒
+        Clock::time_point t0;
+        Clock::time_point measured;
+
+        float at(Clock::time_point now) const {
+            return angle + velocity * std::chrono::duration<float>(now - t0).count();
+        }
+        void setVelocity(float v, Clock::time_point now) {
+            angle = at(now);
+            t0 = now;
+            velocity = v;
+        }
+        // 绝对定位期间设备仍在转动,到达时刻未知,下一次实测前不再推算
+        void moveTo(float target, Clock::time_point now) {
+            fixed = false;
+            angle = target;
+            velocity = 0.f;
+            t0 = now;
+        }
+        void fix(float measuredAngle, Clock::time_point now) {
+            fixed = true;
+            angle = measuredAngle;
+            t0 = now;
+            measured = now;
+        }
+        bool usable(Clock::time_point now, std::chrono::nanoseconds horizon) const {
+            return fixed && now - measured <= horizon;
+        }
+    };
+
+    // 标准命令与扩展命令中的绝对定位、调用预置点;其余扩展命令不影响运动状态
+    static bool affectsMotion(PelcoDCommand cmd) {
+        return !(std::uint16_t(cmd) & 0x0001) || cmd == PelcoDCommand::SetPanPosition || cmd == PelcoDCommand::SetTiltPosition || cmd == PelcoDCommand::CallPreset;
+    }
+
+    mutable std::mutex mMutex;
+    PelcoDMotionModel mModel;
+    std::chrono::nanoseconds mHorizon = std::chrono::seconds(1);
+    Axis mPan;
+    Axis mTilt;
+};
+
+/*!
+ * 大规模设备登记表,按列(SoA)存放地址、总线、缓存的 pan/tilt/zoom、最近一条指令及各自的时间戳.
+ * 每台设备约 50 字节,没有虚函数表、shared_ptr 与字符串,全网扫描只读取需要的列.
+ * 外部以整数句柄引用设备;删除时把最后一台设备移入空位保持各列紧凑,句柄经间接表保持不变.
+ * 时间戳为相对建表时刻的 64 位毫秒数,长期闲置的设备也不会因回绕被当作最新;0 表示未知或已失效.
+ * 非线程安全,通常由所属的工作线程独占.
+ */
+class PelcoDDeviceTable {
+public:
+    using Clock = std::chrono::steady_clock;
+    // 低 24 位为槽位,高 8 位为代数,设备删除后旧句柄失效
+    using Handle = std::uint32_t;
+
+    PelcoDDeviceTable()
+        : mEpoch(Clock::now()) {
+    }
+
+    Handle add(std::uint8_t address, std::uint32_t bus = 0) {
+        std::uint32_t slot;
+        if (!mFree.empty()) {
+            slot = mFree.back();
+            mFree.pop_back();
+        } else {
+            if (mSlots.size() > kSlotMask) {
+                throw std::length_error("pelco-d device table is full");
+            }
+            slot = std::uint32_t(mSlots.size());
+            mSlots.push_back(kNone);
+            mGenerations.push_back(0);
+        }
+        Handle handle = slot | std::uint32_t(mGenerations[slot]) << 24;
+        mSlots[slot] = std::uint32_t(mHandles.size());
+        mHandles.push_back(handle);
+        mAddress.push_back(address);
+        mBus.push_back(bus);
+        for (std::size_t axis = 0; axis < kAxes; ++axis) {
+            mValue[axis].push_back(0);
+            mStamp[axis].push_back(0);
+        }
+        mCommand.push_back(0);
+        mCommandStamp.push_back(0);
+        return handle;
+    }
+    // 句柄无效时抛出 std::out_of_range
+    void remove(Handle handle) {
+        std::uint32_t index = indexOf(handle);
+        std::uint32_t last = std::uint32_t(mHandles.size() - 1);
+        if (index != last) {
+            mHandles[index] = mHandles[last];
+            mAddress[index] = mAddress[last];
+            mBus[index] = mBus[last];
+            for (std::size_t axis = 0; axis < kAxes; ++axis) {
+                mValue[axis][index] = mValue[axis][last];
+                mStamp[axis][index] = mStamp[axis][last];
+            }
+            mCommand[index] = mCommand[last];
+            mCommandStamp[index] = mCommandStamp[last];
+            mSlots[mHandles[index] & kSlotMask] = index;
+        }
+        mHandles.pop_back();
+        mAddress.pop_back();
+        mBus.pop_back();
+        for (std::size_t axis = 0; axis < kAxes; ++axis) {
+            mValue[axis].pop_back();
+            mStamp[axis].pop_back();
+        }
+        mCommand.pop_back();
+        mCommandStamp.pop_back();
+        std::uint32_t slot = handle & kSlotMask;
+        mSlots[slot] = kNone;
+        ++mGenerations[slot];
+        mFree.push_back(slot);
+    }
+    bool contains(Handle handle) const {
+        std::uint32_t slot = handle & kSlotMask;
+        return slot < mSlots.size() && mSlots[slot] != kNone && mGenerations[slot] == std::uint8_t(handle >> 24);
+    }
+    std::size_t size() const {
+        return mHandles.size();
+    }
+    // 第 index 台设备的句柄,用于按列顺序遍历
+    Handle handle(std::size_t index) const {
+        return mHandles[index];
+    }
+
+    std::uint8_t address(Handle handle) const {
+        return mAddress[indexOf(handle)];
+    }
+    std::uint32_t bus(Handle handle) const {
+        return mBus[indexOf(handle)];
+    }
+    // axis 为 Pan/Tilt/Zoom
+    std::uint16_t value(Handle handle, PelcoDQuery axis) const {
+        return mValue[column(axis)][indexOf(handle)];
+    }
+    // 未知或已失效时返回 Clock::time_point()
+    Clock::time_point stamp(Handle handle, PelcoDQuery axis) const {
+        return toTime(mStamp[column(axis)][indexOf(handle)]);
+    }
+    PelcoDCommand lastCommand(Handle handle) const {
+        return PelcoDCommand(mCommand[indexOf(handle)]);
+    }
+    Clock::time_point lastCommandTime(Handle handle) const {
+        return toTime(mCommandStamp[indexOf(handle)]);
+    }
+
+    // 记录发出的指令,会让设备运动的轴的缓存随之失效
+    void command(Handle handle, PelcoDCommand cmd, Clock::time_point now = Clock::now()) {
+        std::uint32_t index = indexOf(handle);
+        mCommand[index] = std::uint16_t(cmd);
+        mCommandStamp[index] = toTicks(now);
+        auto axes = pelcoDMovedAxes(cmd);
+        for (std::size_t axis = 0; axis < kAxes; ++axis) {
+            if (axes & (1u << axis)) {
+                mStamp[axis][index] = 0;
+            }
+        }
+    }
+    // 记录查询结果,axis 为 Pan/Tilt/Zoom
+    void update(Handle handle, PelcoDQuery axis, std::uint16_t value, Clock::time_point now = Clock::now()) {
+        std::uint32_t index = indexOf(handle);
+        mValue[column(axis)][index] = value;
+        mStamp[column(axis)][index] = toTicks(now);
+    }
+    // 把 pan/tilt/zoom 查询的响应帧写入设备,其余帧返回 false
+    bool receive(Handle handle, const PelcoDFrameView& frame, Clock::time_point now = Clock::now()) {
+        PelcoDQuery query;
+        if (!pelcoDQueryFromResponse(frame.command(), query) || std::size_t(query) >= kAxes) {
+            return false;
+        }
+        update(handle, query, frame.value(), now);
+        return true;
+    }
+
+    /*!
+     * 找出 pan/tilt/zoom 任一数据未知或早于 now - staleness 的设备,句柄追加到 out,返回找到的数量.
+     * 三列时间戳逐列比较,AVX2 每次 4 台,其余使用标量实现.
+     */
+    std::size_t stale(std::vector<Handle>& out, Clock::duration staleness, Clock::time_point now = Clock::now()) const {
+        // 早于 oldest 的时间戳已过期,未知的 0 也小于 oldest
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(staleness).count();
+        const std::int64_t oldest = std::max<std::int64_t>(toTicks(now) - std::max<std::int64_t>(ms, 0), 1);
+        const std::size_t count = mHandles.size();
+        const std::size_t before = out.size();
+        std::size_t i = 0;
+#if defined(PELCOD_HAS_AVX2)
+        {
+            const __m256i oldest256 = _mm256_set1_epi64x(oldest);
+            for (; i + 4 <= count; i += 4) {
+                __m256i hit = _mm256_setzero_si256();
+                for (std::size_t axis = 0; axis < kAxes; ++axis) {
+                    __m256i stamp = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mStamp[axis].data() + i));
+                    hit = _mm256_or_si256(hit, _mm256_cmpgt_epi64(oldest256, stamp));
+                }
+                collect(unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(hit))), i, out);
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            if (std::min({mStamp[0][i], mStamp[1][i], mStamp[2][i]}) < oldest) {
+                out.push_back(mHandles[i]);
+            }
+        }
+        return out.size() - before;
+    }
+
+private:
+    static constexpr std::uint32_t kNone = 0xffffffff;
+    static constexpr std::uint32_t kSlotMask = 0x00ffffff;
+    // 只缓存 pan/tilt/zoom
+    static constexpr std::size_t kAxes = 3;
+
+    std::uint32_t indexOf(Handle handle) const {
+        if (!contains(handle)) {
+            throw std::out_of_range("pelco-d device handle is not valid");
+        }
+        return mSlots[handle & kSlotMask];
+    }
+    static std::size_t column(PelcoDQuery axis) {
+        if (std::size_t(axis) >= kAxes) {
+            throw std::invalid_argument("pelco-d device table caches pan/tilt/zoom only");
+        }
+        return std::size_t(axis);
+    }
+    // 毫秒时间戳,早于建表时刻的记为 1,跳过表示未知的 0
+    std::int64_t toTicks(Clock::time_point time) const {
+        auto ticks = std::int64_t(std::chrono::duration_cast<std::chrono::milliseconds>(time - mEpoch).count());
+        return std::max<std::int64_t>(ticks, 1);
+    }
+    Clock::time_point toTime(std::int64_t ticks) const {
+        return ticks == 0 ? Clock::time_point() : mEpoch + std::chrono::milliseconds(ticks);
+    }
+    void collect(unsigned mask, std::size_t base, std::vector<Handle>& out) const {
+        for (; mask != 0; mask &= mask - 1) {
+            unsigned lane = 0;
+            while (!(mask & (1u << lane))) {
+                ++lane;
+            }
+            out.push_back(mHandles[base + lane]);
+        }
+    }
+
+    Clock::time_point mEpoch;
+    // 槽位 → 列下标,空闲槽位为 kNone
+    std::vector<std::uint32_t> mSlots;
+    std::vector<std::uint8_t> mGenerations;
+    std::vector<std::uint32_t> mFree;
+    // 以下各列按下标对齐,列下标 → 句柄
+    std::vector<Handle> mHandles;
+    std::vector<std::uint8_t> mAddress;
+    std::vector<std::uint32_t> mBus;
+    std::array<std::vector<std::uint16_t>, kAxes> mValue;
+    std::array<std::vector<std::int64_t>, kAxes> mStamp;
+    std::vector<std::uint16_t> mCommand;
+    std::vector<std::int64_t> mCommandStamp;
+};
+
 class PelcoDProtocolConfig {
 public:
     virtual std::string ip() const = 0;
@@ -162,6 +1281,15 @@ public:
     virtual void queryTiltPositionResponse(std::uint8_t pos) = 0;
     virtual void queryZoomPositionResponse(std::uint8_t pos) = 0;
     virtual void queryMagnificationResponse(std::uint8_t pos) = 0;
+    // 完整的 16 位位置数据 (data_1 << 8 | data_2),默认忽略
+    virtual void queryPanPositionResponse16(std::uint16_t pos) {
+    }
+    virtual void queryTiltPositionResponse16(std::uint16_t pos) {
+    }
+    virtual void queryZoomPositionResponse16(std::uint16_t pos) {
+    }
+    virtual void queryMagnificationResponse16(std::uint16_t pos) {
+    }
 
     // 用于各种奇葩的厂家扩展
     virtual void setAnyValue(std::uint8_t type, const std::any& value) = 0;
@@ -169,6 +1297,15 @@ public:
 
     // 发送原始字节
     virtual void sendRawCmd(const std::vector<std::uint8_t>& data) = 0;
+    // 立即发送,不拷贝为 std::vector;用于网关转发键盘等上游的原始数据.默认拷贝后转发至上一个重载
+    virtual void sendRawCmd(PelcoDByteView data) {
+        const std::vector<std::uint8_t> copy(data.begin(), data.end());
+        sendRawCmd(copy);
+    }
+    // 转移缓冲区所有权,需要排队的实现可直接接管而不再拷贝.默认转发至 const& 重载
+    virtual void sendRawCmd(std::vector<std::uint8_t>&& data) {
+        sendRawCmd(static_cast<const std::vector<std::uint8_t>&>(data));
+    }
 
     // 红外摄像头
     virtual void infraredZoomIn() = 0;
@@ -228,305 +1365,771 @@ public:
 
     virtual PelcoDProtocolConfig* config() = 0;
 
-    // [isValid,pan,tilt,zoom] [isValid, 0.0~360.0, -90.0~90.0, 0.0 ~ 1.0]
-    virtual std::tuple<bool, float, float, float> ptz() = 0;
+    // [isValid,pan,tilt,zoom] [isValid, 0.0~360.0, -90.0~90.0, 0.0 ~ 1.0]
+    virtual std::tuple<bool, float, float, float> ptz() = 0;
+};
+
+/*!
+ * 指令集的编码逻辑(参数限幅、命令字与数据字节),以 CRTP 方式静态派发,不含任何虚函数.
+ * Derived 需要提供 sendFrame(PelcoDCommand, data_1, data_2)、sendFixedFrame(PelcoDFixedCommand) 与 delay(ms).
+ * 便捷函数(16 位/浮点版本、single*)经由 derived() 调用,Derived 为虚函数类时仍保持虚派发.
+ */
+template <typename Derived>
+class PelcoDCommandSet {
+public:
+    // 向左平移 ←
+    void panLeft(std::uint8_t speed) {
+        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
+        derived().sendFrame(PelcoDCommand::Left, speed, 0x00);
+    }
+    // 向右平移 →
+    void panRight(std::uint8_t speed) {
+        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
+        derived().sendFrame(PelcoDCommand::Right, speed, 0x00);
+    }
+    // 向上倾斜 ↑
+    void tiltUp(std::uint8_t speed) {
+        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
+        derived().sendFrame(PelcoDCommand::Up, 0x00, speed);
+    }
+    // 向下倾斜 ↓
+    void tiltDown(std::uint8_t speed) {
+        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
+        derived().sendFrame(PelcoDCommand::Down, 0x00, speed);
+    }
+    // 左上移动 ←↑
+    void moveLeftUp(std::uint8_t speed) {
+        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
+        derived().sendFrame(PelcoDCommand::Left | PelcoDCommand::Up, speed, speed);
+    }
+    // 右上移动 →↑
+    void moveRightUp(std::uint8_t speed) {
+        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
+        derived().sendFrame(PelcoDCommand::Right | PelcoDCommand::Up, speed, speed);
+    }
+    // 左下移动 ←↓
+    void moveLeftDown(std::uint8_t speed) {
+        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
+        derived().sendFrame(PelcoDCommand::Left | PelcoDCommand::Down, speed, speed);
+    }
+    // 右下移动 →↓
+    void moveRightDown(std::uint8_t speed) {
+        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
+        derived().sendFrame(PelcoDCommand::Right | PelcoDCommand::Down, speed, speed);
+    }
+    // 停止移动
+    void stopMotion(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::StopMotion);
+    }
+
+    // 焦点前调/调近焦点/聚焦近
+    void focusNear(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::FocusNear);
+    }
+    // 焦点后调/调远焦点/聚焦远
+    void focusFar(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::FocusFar);
+    }
+
+    // zoomIn/放大/焦距变大/倍率变大/zoomTele
+    void zoomIn(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::ZoomIn);
+    }
+    // zoomOut/缩小/焦距变小/倍率变小/zoomWide
+    void zoomOut(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::ZoomOut);
+    }
+
+    // 光圈扩大
+    void irisOpen(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::IrisOpen);
+    }
+    // 光圈缩小
+    void irisClose(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::IrisClose);
+    }
+
+    // 扩展指令
+    // 设置预置点
+    void setPreset(std::uint8_t presetID) {
+        // 0x0~0x20
+        presetID = std::clamp<std::uint8_t>(presetID, 0, 0xff);
+        derived().sendFrame(PelcoDCommand::SetPreset, 0x00, presetID);
+    }
+    // 清除预置点
+    void clearPreset(std::uint8_t presetID) {
+        presetID = std::clamp<std::uint8_t>(presetID, 0, 0xff);
+        derived().sendFrame(PelcoDCommand::ClearPreset, 0x00, presetID);
+    }
+    // 调用预置点
+    void callPreset(std::uint8_t presetID) {
+        presetID = std::clamp<std::uint8_t>(presetID, 0, 0xff);
+        derived().sendFrame(PelcoDCommand::CallPreset, 0x00, presetID);
+    }
+
+    // 高级扩展指令
+    // 设置云台绝对值
+    void setPanPosition(std::uint8_t msb, std::uint8_t lsb) {
+        derived().sendFrame(PelcoDCommand::SetPanPosition, msb, lsb);
+    }
+    void setTiltPosition(std::uint8_t msb, std::uint8_t lsb) {
+        derived().sendFrame(PelcoDCommand::SetTiltPosition, msb, lsb);
+    }
+    void setZoomPosition(std::uint8_t msb, std::uint8_t lsb) {
+        derived().sendFrame(PelcoDCommand::SetZoomPosition, msb, lsb);
+    }
+    void setMagnification(std::uint8_t msb, std::uint8_t lsb) {
+        derived().sendFrame(PelcoDCommand::SetMagnification, msb, lsb);
+    }
+
+    /*!
+    * 1) the value to use to set the pan position to 45 degrees is 4500.
+    */
+    void setPanPosition(std::uint16_t pos) {
+        pos = std::clamp<std::uint16_t>(pos, 0, 35999);
+        derived().setPanPosition((pos >> 8) & 0xff, pos & 0xff);
+    }
+    /*!
+    * 1) the value used to set the tilt position to 45 degrees below the horizon, is 4500.
+    * 2) the value used to set the tilt position 30 degrees above the horizon, is 33000.
+    * 3) Zero degrees indicates that the device is pointed horizontally (at the horizon).
+    * 4) Ninety degrees indicates that the device is pointed straight down.
+    */
+    void setTiltPosition(std::uint16_t pos) {
+        pos = std::clamp<std::uint16_t>(pos, 0, 35999);
+        derived().setTiltPosition((pos >> 8) & 0xff, pos & 0xff);
+    }
+    /*!
+    * 镜头物理倍率归一化至 0~65535 区间
+    * current_magnification = (position / 65535) * zoom_limit
+    * position:镜头缩放当前位置
+    * zoom_limit:镜头物理倍率极限(最大)位置
+    */
+    void setZoomPosition(std::uint16_t pos) {
+        derived().setZoomPosition((pos >> 8) & 0xff, pos & 0xff);
+    }
+    /*!
+    * 百分之一放大倍率
+    * 500 = 5X
+    * 1000 = 10x
+    */
+    void setMagnification(std::uint16_t pos) {
+        derived().setMagnification((pos >> 8) & 0xff, pos & 0xff);
+    }
+
+    // 便捷的浮点操作函数
+    // 0.0 ~ 360.0
+    void setPanPosition(std::float_t pos) {
+        pos = std::clamp<std::float_t>(pos, 0.f, 360.f);
+        std::uint16_t value = static_cast<std::uint16_t>(100 * pos);
+        derived().setPanPosition(value);
+    }
+    // -90.0 ~ 90.0
+    void setTiltPosition(std::float_t pos) {
+        pos = std::clamp<std::float_t>(pos, -90.f, 90.f);
+        if (std::isless(pos, 0.f)) {// <
+            derived().setTiltPosition(std::uint16_t(pos * -100.f));
+            return;
+        } else if (std::isgreater(pos, 0.f)) {// >
+            derived().setTiltPosition(std::uint16_t(36000 - pos * 100));
+        } else {
+            derived().setTiltPosition(std::uint16_t(0));
+        }
+    }
+    // 0.0 ~ 1.0
+    void setZoomPosition(std::float_t pos) {
+        pos = std::clamp<std::float_t>(pos, 0.f, 1.f);
+        derived().setZoomPosition(std::uint16_t(65535 * pos));
+    }
+    void setMagnification(std::float_t pos) {
+        throw std::logic_error("use of undefined function");
+    }
+
+    // 查询指令
+    void queryPanPosition(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::QueryPanPosition);
+    }
+    void queryTiltPosition(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::QueryTiltPosition);
+    }
+    void queryZoomPosition(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::QueryZoomPosition);
+    }
+    void queryMagnification(void) {
+        derived().sendFixedFrame(PelcoDFixedCommand::QueryMagnification);
+    }
+
+    // 单次调用函数
+    void singleCall(std::function<void()> func, std::uint32_t delay_ms = 100) {
+        derived().pulse(func, delay_ms);
+    }
+
+    // 便利的单次调用函数
+    // 向左平移 ←
+    void singlePanLeft(std::uint8_t speed, std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().panLeft(speed); }, delay_ms);
+    };
+    // 向右平移 →
+    void singlePanRight(std::uint8_t speed, std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().panRight(speed); }, delay_ms);
+    };
+    // 向上倾斜 ↑
+    void singleTiltUp(std::uint8_t speed, std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().tiltUp(speed); }, delay_ms);
+    };
+    // 向下倾斜 ↓
+    void singleTiltDown(std::uint8_t speed, std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().tiltDown(speed); }, delay_ms);
+    };
+    // 左上移动 ←↑
+    void singleMoveLeftUp(std::uint8_t speed, std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().moveLeftUp(speed); }, delay_ms);
+    };
+    // 右上移动 →↑
+    void singleMoveRightUp(std::uint8_t speed, std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().moveRightUp(speed); }, delay_ms);
+    };
+    // 左下移动 ←↓
+    void singleMoveLeftDown(std::uint8_t speed, std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().moveLeftDown(speed); }, delay_ms);
+    };
+    // 右下移动 →↓
+    void singleMoveRightDown(std::uint8_t speed, std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().moveRightDown(speed); }, delay_ms);
+    };
+
+    // 焦点前调/调近焦点/聚焦近
+    void singleFocusNear(std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().focusNear(); }, delay_ms);
+    };
+    // 焦点后调/调远焦点/聚焦远
+    void singleFocusFar(std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().focusFar(); }, delay_ms);
+    };
+
+    // zoomIn/放大/焦距变大/倍率变大/zoomTele
+    void singleZoomIn(std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().zoomIn(); }, delay_ms);
+    };
+    // zoomOut/缩小/焦距变小/倍率变小/zoomWide
+    void singleZoomOut(std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().zoomOut(); }, delay_ms);
+    };
+
+    // 光圈扩大
+    void singleIrisOpen(std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().irisOpen(); }, delay_ms);
+    };
+    // 光圈缩小
+    void singleIrisClose(std::uint32_t delay_ms = 100) {
+        derived().pulse([&] { derived().irisClose(); }, delay_ms);
+    };
+
+protected:
+    Derived& derived() {
+        return static_cast<Derived&>(*this);
+    }
+    // 执行 start 后等待 delay_ms 再停止;Derived 可提供同名函数改为异步停止
+    template <typename Start>
+    void pulse(Start&& start, std::uint32_t delay_ms) {
+        start();
+        derived().delay(delay_ms);
+        derived().stopMotion();
+    }
+};
+
+/*!
+ * 睡眠到 deadline,single* 的脉宽即转动角度,依赖它的精度.
+ * Linux 下以 CLOCK_MONOTONIC 绝对时间调用 clock_nanosleep,被信号打断后继续等待同一截止时间,不会累积误差;
+ * spin 大于 0 时提前 spin 醒来并忙等剩余时间,以额外的 CPU 换取更小的唤醒抖动.
+ */
+inline void pelcoDSleepUntil(std::chrono::steady_clock::time_point deadline, std::chrono::nanoseconds spin = std::chrono::nanoseconds(0)) {
+    auto wake = deadline - spin;
+#if defined(PELCOD_HAS_CLOCK_NANOSLEEP)
+    // libstdc++/libc++ 的 steady_clock 即 CLOCK_MONOTONIC
+    auto since = std::chrono::duration_cast<std::chrono::nanoseconds>(wake.time_since_epoch()).count();
+    if (since > 0) {
+        timespec ts {time_t(since / 1000000000), long(since % 1000000000)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+    }
+#else
+    std::this_thread::sleep_until(wake);
+#endif
+    while (std::chrono::steady_clock::now() < deadline) {
+#if defined(PELCOD_HAS_SSE2)
+        _mm_pause();
+#endif
+    }
+}
+
+// 标准魔术头 0xff + 地址
+struct PelcoDStandardHeader {
+    static void write(std::uint8_t* frame, std::uint8_t address) {
+        frame[0] = 0xff;
+        frame[1] = address;
+    }
+};
+
+// 标准校验 Byte 2~6 求和取模
+struct PelcoDStandardChecksum {
+    static std::uint8_t compute(const std::uint8_t* frame) {
+        return std::uint8_t(frame[1] + frame[2] + frame[3] + frame[4] + frame[5]);
+    }
+};
+
+/*!
+ * 以编译期策略组合的 Pelco-D 协议实现,整条指令可以内联为若干次存储加一次发送.
+ * Header   :static void write(std::uint8_t* frame, std::uint8_t address),写入 Byte 1~2
+ * Checksum :static std::uint8_t compute(const std::uint8_t* frame),根据 Byte 2~6 计算 Byte 7
+ * Transport:void send(const std::uint8_t* data, std::size_t size)
+ * Derived  :指令集内部调用(single* 的停止、便捷重载)派发到的类型,默认为本类;PelcoDDecoratorStack 将其设为整个栈.
+ * 非标厂家替换 Header/Checksum 即可;需要运行期多态时使用 SimplePelcoDProtocolImpl,两者共享 PelcoDCommandSet.
+ *
+ * BasicPelcoDProtocol<MySerial> ptz(0x01, "/dev/ttyS0");
+ * ptz.panLeft(0x20);
+ */
+template <typename Transport, typename Header = PelcoDStandardHeader, typename Checksum = PelcoDStandardChecksum, typename Derived = void>
+class BasicPelcoDProtocol
+    : public PelcoDCommandSet<std::conditional_t<std::is_void_v<Derived>, BasicPelcoDProtocol<Transport, Header, Checksum>, Derived>> {
+    using Commands = PelcoDCommandSet<std::conditional_t<std::is_void_v<Derived>, BasicPelcoDProtocol<Transport, Header, Checksum>, Derived>>;
+    friend Commands;
+
+public:
+    template <typename... Args>
+    explicit BasicPelcoDProtocol(std::uint8_t address = 0x01, Args&&... args)
+        : mTransport(std::forward<Args>(args)...)
+        , mDeviceAddress(address) {
+    }
+
+    std::uint8_t deviceAddress() const {
+        return mDeviceAddress;
+    }
+    void setDeviceAddress(std::uint8_t address) {
+        mDeviceAddress = address;
+    }
+    Transport& transport() {
+        return mTransport;
+    }
+
+    // 发送原始字节
+    void sendRawCmd(PelcoDByteView data) {
+        mTransport.send(data.data(), data.size());
+    }
+    void delay(std::uint32_t ms) {
+        pelcoDSleepUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(ms));
+    }
+
+protected:
+    void sendFrame(PelcoDCommand cmd, std::uint8_t data_1, std::uint8_t data_2) {
+        std::uint8_t frame[PelcoDFrame::kSize];
+        Header::write(frame, mDeviceAddress);
+        frame[2] = std::uint8_t(std::uint16_t(cmd) >> 8);
+        frame[3] = std::uint8_t(std::uint16_t(cmd) & 0xff);
+        frame[4] = data_1;
+        frame[5] = data_2;
+        frame[6] = Checksum::compute(frame);
+        mTransport.send(frame, PelcoDFrame::kSize);
+    }
+    void sendFixedFrame(PelcoDFixedCommand cmd) {
+        if constexpr (std::is_same_v<Header, PelcoDStandardHeader> && std::is_same_v<Checksum, PelcoDStandardChecksum>) {
+            mTransport.send(pelcoDFixedFrame(mDeviceAddress, cmd).data(), PelcoDFrame::kSize);
+        } else {
+            sendFrame(kPelcoDFixedCommands[std::size_t(cmd)], 0x00, 0x00);
+        }
+    }
+
+private:
+    Transport mTransport;
+    std::uint8_t mDeviceAddress;
+};
+
+/*!
+ * 分层时间轮,一个工作线程驱动大量短定时器.
+ * 共 4 层,每层 256 槽:第 0 层每槽一个 tick(默认 100 微秒),上层每槽覆盖下一层一整圈,到点时逐层下放.
+ * 登记与取消为 O(1);工作线程只在下一个非空槽或层间下放的时刻醒来,按纳秒精度等待.
+ * 任务在工作线程中执行,应尽快返回且不抛出异常.
+ */
+class PelcoDTimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+    using TimerId = std::uint64_t;
+
+    explicit PelcoDTimerWheel(std::chrono::nanoseconds tick = std::chrono::microseconds(100))
+        : mTick(std::max(tick, std::chrono::nanoseconds(std::chrono::microseconds(1))))
+        , mStart(Clock::now()) {
+        for (auto& level : mSlots) {
+            level.fill(kNone);
+        }
+        mThread = std::thread([this] { run(); });
+    }
+    PelcoDTimerWheel(const PelcoDTimerWheel&) = delete;
+    PelcoDTimerWheel& operator=(const PelcoDTimerWheel&) = delete;
+    // 未到期的任务直接丢弃
+    ~PelcoDTimerWheel() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopped = true;
+        }
+        mCond.notify_all();
+        mThread.join();
+    }
+
+    // 线程安全,在 when 之后于工作线程中执行 task,返回值可用于 cancel
+    TimerId schedule(Clock::time_point when, Task task) {
+        // 向上取整到 tick,保证不早于 when 执行
+        std::uint64_t tick = when <= mStart ? 0 : std::uint64_t((when - mStart + mTick - std::chrono::nanoseconds(1)) / mTick);
+        TimerId id;
+        bool earlier;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mCount == 0) {
+                // 轮子为空时直接跳到当前 tick,免得工作线程逐圈走完空闲期间的每次下放
+                mCurrent = std::max(mCurrent, std::uint64_t((Clock::now() - mStart) / mTick));
+            }
+            std::uint32_t index = allocate();
+            Node& node = mNodes[index];
+            node.expiry = std::max(tick, mCurrent);
+            node.task = std::move(task);
+            id = timerId(index);
+            insert(index);
+            ++mCount;
+            earlier = node.expiry < mWakeTick;
+        }
+        if (earlier) {
+            mCond.notify_one();
+        }
+        return id;
+    }
+    TimerId schedule(Clock::duration after, Task task) {
+        return schedule(Clock::now() + after, std::move(task));
+    }
+    // 线程安全,定时器已执行、正在执行或不存在时返回 false
+    bool cancel(TimerId id) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::uint32_t index = std::uint32_t(id);
+        if (index >= mNodes.size() || mNodes[index].generation != std::uint32_t(id >> 32) || !mNodes[index].linked) {
+            return false;
+        }
+        unlink(index);
+        release(index);
+        --mCount;
+        return true;
+    }
+    // 其他线程中等待定时器 id 正在执行的任务结束;id 为 0 或在工作线程中调用时直接返回
+    void quiesce(TimerId id) {
+        if (id == 0 || std::this_thread::get_id() == mThread.get_id()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDone.wait(lock, [&] { return mRunning != id; });
+    }
+    std::size_t pending() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mCount;
+    }
+
+private:
+    static constexpr std::uint32_t kNone = 0xffffffff;
+    static constexpr unsigned kBits = 8;
+    static constexpr std::uint32_t kSlots = 1u << kBits;
+    static constexpr std::uint64_t kMask = kSlots - 1;
+    static constexpr unsigned kLevels = 4;
+
+    struct Node {
+        std::uint64_t expiry = 0;
+        Task task;
+        std::uint32_t prev = kNone;
+        // 空闲节点经由 next 串成空闲链表
+        std::uint32_t next = kNone;
+        std::uint32_t generation = 1;
+        std::uint16_t level = 0;
+        std::uint16_t slot = 0;
+        bool linked = false;
+    };
+
+    // 高 32 位为节点代数,节点复用后旧的 id 失效
+    TimerId timerId(std::uint32_t index) const {
+        return TimerId(mNodes[index].generation) << 32 | index;
+    }
+    std::uint32_t allocate() {
+        if (mFree != kNone) {
+            std::uint32_t index = mFree;
+            mFree = mNodes[index].next;
+            return index;
+        }
+        mNodes.emplace_back();
+        return std::uint32_t(mNodes.size() - 1);
+    }
+    void release(std::uint32_t index) {
+        Node& node = mNodes[index];
+        node.task = nullptr;
+        ++node.generation;
+        node.next = mFree;
+        mFree = index;
+    }
+    // 按距当前 tick 的远近选层,超出最高层范围的在最高层循环下放
+    void insert(std::uint32_t index) {
+        Node& node = mNodes[index];
+        std::uint64_t delta = node.expiry - mCurrent;
+        unsigned level = 0;
+        while (level + 1 < kLevels && delta >= (std::uint64_t(1) << (kBits * (level + 1)))) {
+            ++level;
+        }
+        node.level = std::uint16_t(level);
+        node.slot = std::uint16_t((node.expiry >> (kBits * level)) & kMask);
+        node.prev = kNone;
+        node.next = mSlots[level][node.slot];
+        if (node.next != kNone) {
+            mNodes[node.next].prev = index;
+        }
+        mSlots[level][node.slot] = index;
+        node.linked = true;
+        if (level == 0) {
+            mOccupied[node.slot / 64] |= std::uint64_t(1) << (node.slot % 64);
+        }
+    }
+    void unlink(std::uint32_t index) {
+        Node& node = mNodes[index];
+        if (node.prev != kNone) {
+            mNodes[node.prev].next = node.next;
+        } else {
+            mSlots[node.level][node.slot] = node.next;
+        }
+        if (node.next != kNone) {
+            mNodes[node.next].prev = node.prev;
+        }
+        node.linked = false;
+        if (node.level == 0 && mSlots[0][node.slot] == kNone) {
+            mOccupied[node.slot / 64] &= ~(std::uint64_t(1) << (node.slot % 64));
+        }
+    }
+    // 第 0 层转满一圈时把上层当前槽下放,上层也转满一圈时继续向上
+    void cascade() {
+        for (unsigned level = 1; level < kLevels; ++level) {
+            std::uint32_t slot = std::uint32_t((mCurrent >> (kBits * level)) & kMask);
+            std::uint32_t index = mSlots[level][slot];
+            mSlots[level][slot] = kNone;
+            while (index != kNone) {
+                std::uint32_t next = mNodes[index].next;
+                insert(index);
+                index = next;
+            }
+            if (slot != 0) {
+                break;
+            }
+        }
+    }
+    // 第 0 层 [first, last] 中第一个非空槽,没有时返回 kSlots
+    std::uint32_t occupied(std::uint32_t first, std::uint32_t last) const {
+        for (std::uint32_t word = first / 64; word <= last / 64; ++word) {
+            std::uint64_t bits = mOccupied[word];
+            if (word == first / 64) {
+                bits &= ~std::uint64_t(0) << (first % 64);
+            }
+            if (word == last / 64 && last % 64 != 63) {
+                bits &= (std::uint64_t(1) << (last % 64 + 1)) - 1;
+            }
+            for (std::uint32_t bit = 0; bit < 64; ++bit) {
+                if (bits & (std::uint64_t(1) << bit)) {
+                    return word * 64 + bit;
+                }
+            }
+        }
+        return kSlots;
+    }
+    // 执行当前 tick 到期的任务;任务执行期间不持锁,同槽中新登记的下一圈定时器被跳过
+    void expire(std::unique_lock<std::mutex>& lock) {
+        std::uint64_t tick = mCurrent++;
+        std::uint32_t slot = std::uint32_t(tick & kMask);
+        for (;;) {
+            std::uint32_t index = mSlots[0][slot];
+            while (index != kNone && mNodes[index].expiry != tick) {
+                index = mNodes[index].next;
+            }
+            if (index == kNone) {
+                return;
+            }
+            unlink(index);
+            Task task = std::move(mNodes[index].task);
+            mRunning = timerId(index);
+            release(index);
+            --mCount;
+            lock.unlock();
+            task();
+            task = nullptr;
+            lock.lock();
+            mRunning = 0;
+            mDone.notify_all();
+        }
+    }
+    void run() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStopped) {
+            mWakeTick = 0;
+            auto now = std::uint64_t((Clock::now() - mStart) / mTick);
+            while (mCurrent <= now) {
+                if ((mCurrent & kMask) == 0) {
+                    cascade();
+                }
+                // 跳过本圈内的空槽,不越过下一次下放
+                std::uint64_t last = std::min(now, mCurrent | kMask);
+                std::uint32_t slot = occupied(std::uint32_t(mCurrent & kMask), std::uint32_t(last & kMask));
+                if (slot == kSlots) {
+                    mCurrent = last + 1;
+                    continue;
+                }
+                mCurrent = (mCurrent & ~kMask) + slot;
+                expire(lock);
+            }
+            if (mStopped) {
+                break;
+            }
+            if (mCount == 0) {
+                mWakeTick = std::numeric_limits<std::uint64_t>::max();
+                mCond.wait(lock);
+                continue;
+            }
+            std::uint32_t slot = occupied(std::uint32_t(mCurrent & kMask), kSlots - 1);
+            if (slot != kSlots) {
+                mWakeTick = (mCurrent & ~kMask) + slot;
+            } else {
+                mWakeTick = (mCurrent & kMask) == 0 ? mCurrent : (mCurrent | kMask) + 1;
+            }
+            mCond.wait_until(lock, mStart + mTick * mWakeTick);
+        }
+    }
+
+    const std::chrono::nanoseconds mTick;
+    const Clock::time_point mStart;
+    mutable std::mutex mMutex;
+    std::condition_variable mCond;
+    std::condition_variable mDone;
+    std::vector<Node> mNodes;
+    std::uint32_t mFree = kNone;
+    std::array<std::array<std::uint32_t, kSlots>, kLevels> mSlots;
+    std::array<std::uint64_t, kSlots / 64> mOccupied {};
+    // 下一个待处理的 tick
+    std::uint64_t mCurrent = 0;
+    // 工作线程计划醒来的 tick,更早的定时器需要唤醒它
+    std::uint64_t mWakeTick = 0;
+    std::size_t mCount = 0;
+    TimerId mRunning = 0;
+    bool mStopped = false;
+    std::thread mThread;
 };
 
-class SimplePelcoDProtocolImpl : public SimplePelcoDProtocol {
+class SimplePelcoDProtocolImpl : public SimplePelcoDProtocol
+    , protected PelcoDCommandSet<SimplePelcoDProtocolImpl> {
+    using Commands = PelcoDCommandSet<SimplePelcoDProtocolImpl>;
+    friend Commands;
+
 public:
+    SimplePelcoDProtocolImpl() {
+        mQueries.setSender([this](std::uint8_t, PelcoDQuery query) { sendQuery(query); });
+    }
     virtual ~SimplePelcoDProtocolImpl() {
+        cancelPulse();
     }
     // 向左平移 ←
     virtual void panLeft(std::uint8_t speed) override {
-        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.left = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(speed);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::panLeft(speed);
     }
     // 向右平移 →
     virtual void panRight(std::uint8_t speed) override {
-        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.right = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(speed);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::panRight(speed);
     }
     // 向上倾斜 ↑
     virtual void tiltUp(std::uint8_t speed) override {
-        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.up = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(0x00);
-        cmd.push_back(speed);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::tiltUp(speed);
     }
     // 向下倾斜 ↓
     virtual void tiltDown(std::uint8_t speed) override {
-        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.down = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(0x00);
-        cmd.push_back(speed);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::tiltDown(speed);
     }
     // 左上移动 ←↑
     virtual void moveLeftUp(std::uint8_t speed) override {
-        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.left = 1;
-        standard_cmd._cmd.up = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(speed);
-        cmd.push_back(speed);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::moveLeftUp(speed);
     }
     // 右上移动 →↑
     virtual void moveRightUp(std::uint8_t speed) override {
-        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.right = 1;
-        standard_cmd._cmd.up = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(speed);
-        cmd.push_back(speed);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::moveRightUp(speed);
     }
     // 左下移动 ←↓
     virtual void moveLeftDown(std::uint8_t speed) override {
-        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.left = 1;
-        standard_cmd._cmd.down = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(speed);
-        cmd.push_back(speed);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::moveLeftDown(speed);
     }
     // 右下移动 →↓
     virtual void moveRightDown(std::uint8_t speed) override {
-        speed = std::clamp<std::uint8_t>(speed, 0, 0x3f);
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.right = 1;
-        standard_cmd._cmd.down = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(speed);
-        cmd.push_back(speed);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::moveRightDown(speed);
     }
     // 停止移动
     virtual void stopMotion(void) override {
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::stopMotion();
     }
 
     // 焦点前调/调近焦点/聚焦近
     virtual void focusNear(void) override {
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.focus_near = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::focusNear();
     }
     // 焦点后调/调远焦点/聚焦远
     virtual void focusFar(void) override {
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.focus_far = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::focusFar();
     }
 
     // zoomIn/放大/焦距变大/倍率变大/zoomTele
     virtual void zoomIn(void) override {
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.zoom_tele = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::zoomIn();
     }
     // zoomOut/缩小/焦距变小/倍率变小/zoomWide
     virtual void zoomOut(void) override {
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.zoom_wide = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::zoomOut();
     }
 
     // 光圈扩大
     virtual void irisOpen(void) override {
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.iris_open = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::irisOpen();
     }
     // 光圈缩小
     virtual void irisClose(void) override {
-        auto cmd = magic();
-        StandardCMD standard_cmd;
-        standard_cmd._cmd.iris_close = 1;
-        auto& std_cmd = standard_cmd.cmd;
-        cmd.push_back(std_cmd.cmd_1);
-        cmd.push_back(std_cmd.cmd_2);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::irisClose();
     }
 
     // 扩展指令
     // 设置预置点
     virtual void setPreset(std::uint8_t presetID) override {
-        // 0x0~0x20
-        presetID = std::clamp<std::uint8_t>(presetID, 0, 0xff);
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x03);
-        cmd.push_back(0x00);
-        cmd.push_back(presetID);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::setPreset(presetID);
     }
     // 清除预置点
     virtual void clearPreset(std::uint8_t presetID) override {
-        presetID = std::clamp<std::uint8_t>(presetID, 0, 0xff);
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x05);
-        cmd.push_back(0x00);
-        cmd.push_back(presetID);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::clearPreset(presetID);
     }
     // 调用预置点
     virtual void callPreset(std::uint8_t presetID) override {
-        presetID = std::clamp<std::uint8_t>(presetID, 0, 0xff);
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x07);
-        cmd.push_back(0x00);
-        cmd.push_back(presetID);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::callPreset(presetID);
     }
 
     // 高级扩展指令
     // 设置云台绝对值
     virtual void setPanPosition(std::uint8_t msb, std::uint8_t lsb) override {
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x4B);
-        cmd.push_back(msb);
-        cmd.push_back(lsb);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::setPanPosition(msb, lsb);
     }
     virtual void setTiltPosition(std::uint8_t msb, std::uint8_t lsb) override {
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x4D);
-        cmd.push_back(msb);
-        cmd.push_back(lsb);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::setTiltPosition(msb, lsb);
     }
     virtual void setZoomPosition(std::uint8_t msb, std::uint8_t lsb) override {
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x4F);
-        cmd.push_back(msb);
-        cmd.push_back(lsb);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::setZoomPosition(msb, lsb);
     }
     virtual void setMagnification(std::uint8_t msb, std::uint8_t lsb) override {
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x5F);
-        cmd.push_back(msb);
-        cmd.push_back(lsb);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::setMagnification(msb, lsb);
     }
 
     /*!
     * 1) the value to use to set the pan position to 45 degrees is 4500.
     */
     virtual void setPanPosition(std::uint16_t pos) override {
-        pos = std::clamp<std::uint16_t>(pos, 0, 35999);
-        setPanPosition((pos >> 8) & 0xff, pos & 0xff);
+        Commands::setPanPosition(pos);
     }
     /*!
     * 1) the value used to set the tilt position to 45 degrees below the horizon, is 4500.
@@ -535,8 +2138,7 @@ public:
     * 4) Ninety degrees indicates that the device is pointed straight down.
     */
     virtual void setTiltPosition(std::uint16_t pos) override {
-        pos = std::clamp<std::uint16_t>(pos, 0, 35999);
-        setTiltPosition((pos >> 8) & 0xff, pos & 0xff);
+        Commands::setTiltPosition(pos);
     }
     /*!
     * 镜头物理倍率归一化至 0~65535 区间
@@ -545,7 +2147,7 @@ public:
     * zoom_limit:镜头物理倍率极限(最大)位置
     */
     virtual void setZoomPosition(std::uint16_t pos) override {
-        setZoomPosition((pos >> 8) & 0xff, pos & 0xff);
+        Commands::setZoomPosition(pos);
     }
     /*!
     * 百分之一放大倍率
@@ -553,32 +2155,21 @@ public:
     * 1000 = 10x
     */
     virtual void setMagnification(std::uint16_t pos) override {
-        setMagnification((pos >> 8) & 0xff, pos & 0xff);
+        Commands::setMagnification(pos);
     }
 
     // 便捷的浮点操作函数
     // 0.0 ~ 360.0
     virtual void setPanPosition(std::float_t pos) override {
-        pos = std::clamp<std::float_t>(pos, 0.f, 360.f);
-        std::uint16_t value = static_cast<std::uint16_t>(100 * pos);
-        setPanPosition(value);
+        Commands::setPanPosition(pos);
     }
     // -90.0 ~ 90.0
     virtual void setTiltPosition(std::float_t pos) override {
-        pos = std::clamp<std::float_t>(pos, -90.f, 90.f);
-        if (std::isless(pos, 0.f)) {// <
-            setTiltPosition(std::uint16_t(pos * -100.f));
-            return;
-        } else if (std::isgreater(pos, 0.f)) {// >
-            setTiltPosition(std::uint16_t(36000 - pos * 100));
-        } else {
-            setTiltPosition(std::uint16_t(0));
-        }
+        Commands::setTiltPosition(pos);
     }
     // 0.0 ~ 1.0
     virtual void setZoomPosition(std::float_t pos) override {
-        pos = std::clamp<std::float_t>(pos, 0.f, 1.f);
-        setZoomPosition(std::uint16_t(65535 * pos));
+        Commands::setZoomPosition(pos);
     }
     virtual void setMagnification(std::float_t pos) override {
         throw std::logic_error("use of undefined function");
@@ -586,44 +2177,21 @@ public:
 
     // 查询指令
     virtual void queryPanPosition(void) override {
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x51);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::queryPanPosition();
     }
     virtual void queryTiltPosition(void) override {
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x53);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::queryTiltPosition();
     }
     virtual void queryZoomPosition(void) override {
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x55);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::queryZoomPosition();
     }
     virtual void queryMagnification(void) override {
-        auto cmd = magic();
-        cmd.push_back(0x00);
-        cmd.push_back(0x61);
-        cmd.push_back(0x00);
-        cmd.push_back(0x00);
-        cmd.push_back(checkSum(cmd));
-        sendData(cmd);
+        Commands::queryMagnification();
     }
 
     // 响应查询指令
-    // 需要重写 virtual void receiveData(const std::vector<std::uint8_t>& data) 函数并在里面调用下面的响应函数.
+    // 8 位版本只能携带低字节,不足以还原位置,保持未实现,以免错误的值进入状态缓存与查询结果;
+    // receiveData 解析出响应帧后调用 16 位版本.
     virtual void queryPanPositionResponse(std::uint8_t pos) override {
         throw std::logic_error("use of undefined function");
     }
@@ -636,6 +2204,23 @@ public:
     virtual void queryMagnificationResponse(std::uint8_t pos) override {
         throw std::logic_error("use of undefined function");
     }
+    virtual void queryPanPositionResponse16(std::uint16_t pos) override {
+        mEstimator.correct(PelcoDQuery::Pan, pos);
+        mState.update(PelcoDQuery::Pan, pos);
+        mQueries.complete(mDeviceAddress, PelcoDQuery::Pan, pos);
+    }
+    virtual void queryTiltPositionResponse16(std::uint16_t pos) override {
+        mEstimator.correct(PelcoDQuery::Tilt, pos);
+        mState.update(PelcoDQuery::Tilt, pos);
+        mQueries.complete(mDeviceAddress, PelcoDQuery::Tilt, pos);
+    }
+    virtual void queryZoomPositionResponse16(std::uint16_t pos) override {
+        mState.update(PelcoDQuery::Zoom, pos);
+        mQueries.complete(mDeviceAddress, PelcoDQuery::Zoom, pos);
+    }
+    virtual void queryMagnificationResponse16(std::uint16_t pos) override {
+        mQueries.complete(mDeviceAddress, PelcoDQuery::Magnification, pos);
+    }
 
     // 用于各种奇葩的厂家扩展
     // 0:设置设备ID
@@ -643,7 +2228,12 @@ public:
         try {
             switch (type) {
             case 0: {
-                mDeviceAddress = std::any_cast<std::uint8_t>(value);
+                auto address = std::any_cast<std::uint8_t>(value);
+                if (address != mDeviceAddress) {
+                    mDeviceAddress = address;
+                    // magic() 可能只对部分地址是标准实现,换地址后重新探测
+                    mFrameMode.store(FrameMode::Unknown, std::memory_order_release);
+                }
                 break;
             }
             default: break;
@@ -664,21 +2254,22 @@ public:
 
     // 发送原始字节
     virtual void sendRawCmd(const std::vector<std::uint8_t>& data) override {
+        this->sendData(PelcoDByteView(data));
+    }
+    virtual void sendRawCmd(PelcoDByteView data) override {
         this->sendData(data);
     }
+    virtual void sendRawCmd(std::vector<std::uint8_t>&& data) override {
+        this->sendData(std::move(data));
+    }
 
     // 红外摄像头
+    // 红外机芯固定使用地址 0x02,直接按该地址组帧,不改写本设备地址
     virtual void infraredZoomIn() override {
-        auto old = getAnyValue(0);
-        setAnyValue(0, std::make_any<std::uint8_t>(0x02));
-        this->zoomIn();
-        setAnyValue(0, old);
+        sendFixedFrameTo(kInfraredAddress, PelcoDFixedCommand::ZoomIn);
     };
     virtual void infraredZoomOut() override {
-        auto old = getAnyValue(0);
-        setAnyValue(0, std::make_any<std::uint8_t>(0x02));
-        this->zoomOut();
-        setAnyValue(0, old);
+        sendFixedFrameTo(kInfraredAddress, PelcoDFixedCommand::ZoomOut);
     };
 
     virtual void connect() override {
@@ -694,8 +2285,23 @@ public:
         throw std::logic_error("use of undefined function | virtual void notify(const std::any& value)");
     };
 
+    // 以绝对截止时间睡眠,精度见 pelcoDSleepUntil
     virtual void delay(const std::uint32_t& ms) override {
-        throw std::logic_error("use of undefined function | virtual void delay(const std::int32_t& ms)");
+        pelcoDSleepUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(ms), mDelaySpin.load());
+    }
+    // delay() 结束前忙等的时长,默认 0 即纯睡眠;设为 50~200 微秒可把唤醒误差压到微秒级
+    void setDelaySpin(std::chrono::nanoseconds spin) {
+        mDelaySpin = spin;
+    }
+
+    /*!
+     * 设置后 single* 函数发出运动指令即返回,停止指令由时间轮按时发出,同一设备新的单次调用取代尚未发出的停止指令.
+     * 时间轮可由多个设备共用;传入 nullptr 恢复为在调用线程中 delay() 后停止.
+     */
+    void setTimerWheel(std::shared_ptr<PelcoDTimerWheel> wheel) {
+        cancelPulse();
+        std::lock_guard<std::mutex> lock(mPulseMutex);
+        mTimerWheel = std::move(wheel);
     }
 
     virtual void updateConfig(const std::any& config) override {
@@ -708,106 +2314,192 @@ public:
 
     // 单次调用函数
     virtual void singleCall(std::function<void()> func, std::uint32_t delay_ms = 100) override {
-        func();
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleCall(func, delay_ms);
     }
 
     // 便利的单次调用函数
     // 向左平移 ←
     virtual void singlePanLeft(std::uint8_t speed, std::uint32_t delay_ms = 100) override {
-        panLeft(speed);
-        delay(delay_ms);
-        stopMotion();
+        Commands::singlePanLeft(speed, delay_ms);
     };
     // 向右平移 →
     virtual void singlePanRight(std::uint8_t speed, std::uint32_t delay_ms = 100) override {
-        panRight(speed);
-        delay(delay_ms);
-        stopMotion();
+        Commands::singlePanRight(speed, delay_ms);
     };
     // 向上倾斜 ↑
     virtual void singleTiltUp(std::uint8_t speed, std::uint32_t delay_ms = 100) override {
-        tiltUp(speed);
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleTiltUp(speed, delay_ms);
     };
     // 向下倾斜 ↓
     virtual void singleTiltDown(std::uint8_t speed, std::uint32_t delay_ms = 100) override {
-        tiltDown(speed);
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleTiltDown(speed, delay_ms);
     };
     // 左上移动 ←↑
     virtual void singleMoveLeftUp(std::uint8_t speed, std::uint32_t delay_ms = 100) override {
-        moveLeftUp(speed);
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleMoveLeftUp(speed, delay_ms);
     };
     // 右上移动 →↑
     virtual void singleMoveRightUp(std::uint8_t speed, std::uint32_t delay_ms = 100) override {
-        moveRightUp(speed);
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleMoveRightUp(speed, delay_ms);
     };
     // 左下移动 ←↓
     virtual void singleMoveLeftDown(std::uint8_t speed, std::uint32_t delay_ms = 100) override {
-        moveLeftDown(speed);
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleMoveLeftDown(speed, delay_ms);
     };
     // 右下移动 →↓
     virtual void singleMoveRightDown(std::uint8_t speed, std::uint32_t delay_ms = 100) override {
-        moveRightDown(speed);
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleMoveRightDown(speed, delay_ms);
     };
 
     // 焦点前调/调近焦点/聚焦近
     virtual void singleFocusNear(std::uint32_t delay_ms = 100) override {
-        focusNear();
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleFocusNear(delay_ms);
     };
     // 焦点后调/调远焦点/聚焦远
     virtual void singleFocusFar(std::uint32_t delay_ms = 100) override {
-        focusFar();
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleFocusFar(delay_ms);
     };
 
     // zoomIn/放大/焦距变大/倍率变大/zoomTele
     virtual void singleZoomIn(std::uint32_t delay_ms = 100) override {
-        zoomIn();
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleZoomIn(delay_ms);
     };
     // zoomOut/缩小/焦距变小/倍率变小/zoomWide
     virtual void singleZoomOut(std::uint32_t delay_ms = 100) override {
-        zoomOut();
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleZoomOut(delay_ms);
     };
 
     // 光圈扩大
     virtual void singleIrisOpen(std::uint32_t delay_ms = 100) override {
-        irisOpen();
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleIrisOpen(delay_ms);
     };
     // 光圈缩小
     virtual void singleIrisClose(std::uint32_t delay_ms = 100) override {
-        irisClose();
-        delay(delay_ms);
-        stopMotion();
+        Commands::singleIrisClose(delay_ms);
     };
 
     virtual PelcoDProtocolConfig* config() override {
         return mConfig.operator->();
     }
 
+    /*!
+     * 缓存在有效期内时直接返回缓存值,不访问总线;
+     * 缓存过期但航位推算仍可信且变倍未改变时返回推算值;
+     * 否则以流水线方式查询 pan/tilt/zoom,三者全部响应或任一超时后返回;
+     * 在事件循环线程中调用时不等待,发出查询后返回缓存中的旧值,从未有过缓存时返回 false.
+     * 发送失败(例如没有传输层)时返回 false.
+     * 有效期通过 stateCache().setStaleness() 设置,推算时长通过 motionEstimator().setHorizon() 设置.
+     */
     virtual std::tuple<bool, float, float, float> ptz() override {
-        return std::make_tuple<bool, float, float, float>(false, 0.f, 0.f, 0.f);
+        PelcoDPosition position;
+        if (mState.fresh(position)) {
+            return position.ptz();
+        }
+        float pan, tilt;
+        if (mState.stamp(PelcoDQuery::Zoom) != PelcoDStateCache::Clock::time_point() && mEstimator.estimate(pan, tilt)) {
+            return std::make_tuple(true, pan, tilt, position.zoomRatio());
+        }
+        std::future<PelcoDPosition> future;
+        try {
+            future = asyncQueryPTZ();
+        } catch (const std::exception&) {
+            return std::make_tuple<bool, float, float, float>(false, 0.f, 0.f, 0.f);
+        }
+        // 事件循环线程中等待会挡住响应的分发:查询照常发出以刷新缓存,本次返回缓存中的旧值
+        if (inEventLoop()) {
+            PelcoDStateCache::Clock::time_point oldest;
+            mState.get(position, oldest);
+            if (oldest != PelcoDStateCache::Clock::time_point()) {
+                return position.ptz();
+            }
+            return std::make_tuple<bool, float, float, float>(false, 0.f, 0.f, 0.f);
+        }
+        for (auto next = mQueries.poll(); future.wait_until(std::min(next, PelcoDQueryTracker::Clock::now() + std::chrono::seconds(1))) != std::future_status::ready; next = mQueries.poll()) {
+        }
+        try {
+            return future.get().ptz();
+        } catch (const std::runtime_error&) {
+            return std::make_tuple<bool, float, float, float>(false, 0.f, 0.f, 0.f);
+        }
+    }
+
+    // 接收统计
+    const PelcoDParserStats& receiveStats() const {
+        return mParser.stats();
+    }
+
+    /*!
+     * 异步查询,响应到达后得到完整的 16 位数据,超时(含重发)后回调 ok=false 或 future 抛出异常.
+     * 超时与重发次数通过 queryTracker() 设置,响应延迟通过 queryTracker().latency(address) 获取.
+     */
+    void asyncQuery(PelcoDQuery query, PelcoDQueryTracker::Callback callback) {
+        mQueries.submit(mDeviceAddress, query, std::move(callback));
+        watchQueries();
+    }
+    std::future<std::uint16_t> asyncQuery(PelcoDQuery query) {
+        auto future = mQueries.submit(mDeviceAddress, query);
+        watchQueries();
+        return future;
+    }
+    PelcoDQueryTracker& queryTracker() {
+        return mQueries;
+    }
+    PelcoDStateCache& stateCache() {
+        return mState;
+    }
+    PelcoDMotionEstimator& motionEstimator() {
+        return mEstimator;
+    }
+
+    /*!
+     * 流水线查询:不等待响应,连续发出 queryPanPosition/queryTiltPosition/queryZoomPosition,
+     * 响应按到达顺序收集,三者齐全后一次回调,整体耗时约为一次往返.发送失败不抛出异常,回调 ok=false.
+     */
+    void asyncQueryPTZ(std::function<void(bool ok, const PelcoDPosition& position)> callback) {
+        struct Gather {
+            std::function<void(bool, const PelcoDPosition&)> callback;
+            PelcoDPosition position;
+            std::atomic<int> remaining{3};
+            std::atomic<bool> ok{true};
+        };
+        auto gather = std::make_shared<Gather>();
+        gather->callback = std::move(callback);
+        auto collect = [gather](std::uint16_t PelcoDPosition::*field) {
+            return [gather, field](bool ok, std::uint16_t value) {
+                if (ok) {
+                    gather->position.*field = value;
+                } else {
+                    gather->ok = false;
+                }
+                if (--gather->remaining == 0) {
+                    gather->callback(gather->ok, gather->position);
+                }
+            };
+        };
+        // 发送失败的轴按超时处理,已发出的轴照常等待响应,回调总会被调用一次
+        for (auto item : {std::make_pair(PelcoDQuery::Pan, &PelcoDPosition::pan),
+                          std::make_pair(PelcoDQuery::Tilt, &PelcoDPosition::tilt),
+                          std::make_pair(PelcoDQuery::Zoom, &PelcoDPosition::zoom)}) {
+            auto callback = collect(item.second);
+            try {
+                mQueries.submit(mDeviceAddress, item.first, callback);
+            } catch (const std::exception&) {
+                callback(false, 0);
+            }
+        }
+        watchQueries();
+    }
+    std::future<PelcoDPosition> asyncQueryPTZ() {
+        auto promise = std::make_shared<std::promise<PelcoDPosition>>();
+        auto future = promise->get_future();
+        asyncQueryPTZ([promise](bool ok, const PelcoDPosition& position) {
+            if (ok) {
+                promise->set_value(position);
+            } else {
+                promise->set_exception(std::make_exception_ptr(std::runtime_error("pelco-d query timeout")));
+            }
+        });
+        return future;
     }
 
 protected:
@@ -815,9 +2507,61 @@ protected:
     virtual void sendData(const std::vector<std::uint8_t>& data) {
         throw std::logic_error("use of undefined function | virtual void sendData(const std::vector<std::uint8_t>& data)");
     }
+    /*!
+     * 零拷贝发送接口,所有指令最终经由该函数发送.
+     * 默认实现拷贝为 std::vector 后转发至旧接口以兼容已有子类,重载该函数即可避免堆内存申请.
+     * 注意:子类只重载其中一个 sendData 时需 using SimplePelcoDProtocolImpl::sendData; 以免隐藏另一个重载.
+     */
+    virtual void sendData(PelcoDByteView data) {
+        // 具名左值,临时对象会绑定到下面的 && 重载,形成无限递归
+        const std::vector<std::uint8_t> copy(data.begin(), data.end());
+        sendData(copy);
+    }
+    // 调用者交出缓冲区所有权,排队发送的子类可重载该函数直接接管;默认按视图发送
+    virtual void sendData(std::vector<std::uint8_t>&& data) {
+        sendData(PelcoDByteView(data));
+    }
+    /*!
+     * 提交查询后调用.超时与重发只在 mQueries.poll() 中推进,默认由 receiveData 与 ptz() 驱动;
+     * 有事件循环的派生类重载该函数,在 mQueries.nextDeadline() 安排定时器调用 poll(),设备不响应时查询也能按时结束.
+     */
+    virtual void watchQueries() {
+    }
+    // 当前线程是否为分发响应的事件循环线程,是则 ptz() 不能阻塞等待
+    virtual bool inEventLoop() {
+        return false;
+    }
     // 重载该函数处理接收数据逻辑
     virtual void receiveData(const std::vector<std::uint8_t>& data) {
-        throw std::logic_error("use of undefined function | virtual void receiveData(const std::vector<std::uint8_t>& data)");
+        receiveData(PelcoDByteView(data));
+    }
+    // 接收串口读到的任意字节片段,解析出的每一帧交给 receiveFrame 处理
+    virtual void receiveData(PelcoDByteView data) {
+        mParser.feed(data, [this](const PelcoDFrameView& frame) { receiveFrame(frame); });
+        mQueries.poll();
+    }
+    // 重载该函数处理解析出的完整帧,默认将本设备的查询响应分发给 query*Response
+    virtual void receiveFrame(const PelcoDFrameView& frame) {
+        PelcoDQuery query;
+        if (frame.address() != mDeviceAddress || !pelcoDQueryFromResponse(frame.command(), query)) {
+            return;
+        }
+        switch (query) {
+        case PelcoDQuery::Pan: queryPanPositionResponse16(frame.value()); break;
+        case PelcoDQuery::Tilt: queryTiltPositionResponse16(frame.value()); break;
+        case PelcoDQuery::Zoom: queryZoomPositionResponse16(frame.value()); break;
+        case PelcoDQuery::Magnification: queryMagnificationResponse16(frame.value()); break;
+        default: break;
+        }
+    }
+    void sendQuery(PelcoDQuery query) {
+        switch (query) {
+        case PelcoDQuery::Pan: queryPanPosition(); break;
+        case PelcoDQuery::Tilt: queryTiltPosition(); break;
+        case PelcoDQuery::Zoom: queryZoomPosition(); break;
+        case PelcoDQuery::Magnification: queryMagnification(); break;
+        default: break;
+        }
     }
     // 魔术头
     virtual std::vector<uint8_t> magic() {
@@ -832,13 +2576,367 @@ protected:
         return sum % 0x100;
     }
 
+    /*!
+     * 组帧并发送.
+     * 标准协议下直接在栈上构造 PelcoDFrame;
+     * 非标厂家重写了 magic()/checkSum() 时回落到 std::vector 组帧,保证其行为不变.
+     */
+    void sendFrame(std::uint8_t cmd_1, std::uint8_t cmd_2, std::uint8_t data_1, std::uint8_t data_2) {
+        sendFrameTo(mDeviceAddress, cmd_1, cmd_2, data_1, data_2);
+        trackCommand(PelcoDCommand(cmd_1 << 8 | cmd_2), data_1, data_2);
+    }
+    /*!
+     * 向 address 组帧发送,不记入本设备的状态缓存.
+     * 非标魔术头的第 2 字节等于本设备地址时替换为 address,其余非标魔术头原样使用.
+     */
+    void sendFrameTo(std::uint8_t address, std::uint8_t cmd_1, std::uint8_t cmd_2, std::uint8_t data_1, std::uint8_t data_2) {
+        if (isStandardFrame()) {
+            PelcoDFrame frame(address, cmd_1, cmd_2, data_1, data_2);
+            sendData(frame.view());
+            return;
+        }
+        auto device = mDeviceAddress;
+        auto cmd = magic();
+        if (address != device && cmd.size() > 1 && cmd[1] == device) {
+            cmd[1] = address;
+        }
+        cmd.push_back(cmd_1);
+        cmd.push_back(cmd_2);
+        cmd.push_back(data_1);
+        cmd.push_back(data_2);
+        cmd.push_back(checkSum(cmd));
+        sendData(PelcoDByteView(cmd));
+    }
+
+    void sendFrame(PelcoDCommand cmd, std::uint8_t data_1, std::uint8_t data_2) {
+        sendFrame(std::uint8_t(std::uint16_t(cmd) >> 8), std::uint8_t(std::uint16_t(cmd) & 0xff), data_1, data_2);
+    }
+    // single* 的实现:有时间轮时异步停止,否则阻塞等待
+    template <typename Start>
+    void pulse(Start&& start, std::uint32_t delay_ms) {
+        std::unique_lock<std::mutex> lock(mPulseMutex);
+        if (!mTimerWheel) {
+            lock.unlock();
+            Commands::pulse(std::forward<Start>(start), delay_ms);
+            return;
+        }
+        // 运动指令与停止任务都在锁内,旧的停止任务即使已开始执行也会因序号变化而放弃
+        auto sequence = ++mPulseSequence;
+        mTimerWheel->cancel(mPendingStop);
+        start();
+        mPendingStop = mTimerWheel->schedule(std::chrono::milliseconds(delay_ms), [this, sequence] {
+            std::lock_guard<std::mutex> lock(mPulseMutex);
+            if (sequence != mPulseSequence) {
+                return;
+            }
+            mPendingStop = 0;
+            try {
+                stopMotion();
+            } catch (const std::exception& e) {
+                std::cout << e.what() << std::endl;
+            }
+        });
+    }
+    // 取消尚未发出的停止指令并等待正在执行的停止任务结束;派生类析构时应先调用
+    void cancelPulse() {
+        std::shared_ptr<PelcoDTimerWheel> wheel;
+        PelcoDTimerWheel::TimerId id;
+        {
+            std::lock_guard<std::mutex> lock(mPulseMutex);
+            ++mPulseSequence;
+            wheel = mTimerWheel;
+            id = mPendingStop;
+            mPendingStop = 0;
+        }
+        if (wheel) {
+            wheel->cancel(id);
+            wheel->quiesce(id);
+        }
+    }
+    // 固定指令直接取自编译期生成的帧表
+    void sendFixedFrame(PelcoDFixedCommand cmd) {
+        bool standard = isStandardFrame();
+        const auto& frame = pelcoDFixedFrame(mDeviceAddress, cmd);
+        if (standard) {
+            sendData(frame.view());
+            trackCommand(kPelcoDFixedCommands[std::size_t(cmd)], 0x00, 0x00);
+            return;
+        }
+        sendFrame(frame.bytes[2], frame.bytes[3], frame.bytes[4], frame.bytes[5]);
+    }
+    void sendFixedFrameTo(std::uint8_t address, PelcoDFixedCommand cmd) {
+        const auto& frame = pelcoDFixedFrame(address, cmd);
+        if (isStandardFrame()) {
+            sendData(frame.view());
+            return;
+        }
+        sendFrameTo(address, frame.bytes[2], frame.bytes[3], frame.bytes[4], frame.bytes[5]);
+    }
+
+    // 已发出的指令会让设备开始运动时,相应轴的缓存失效,并交给航位推算
+    void trackCommand(PelcoDCommand cmd, std::uint8_t data_1, std::uint8_t data_2) {
+        mEstimator.command(cmd, data_1, data_2);
+        mState.invalidate(pelcoDMovedAxes(cmd));
+    }
+
+    /*!
+     * 探测 magic()/checkSum() 是否为标准实现,首次发送及设备地址改变后各执行一次.
+     * 魔术头按当前地址探测,校验函数使用含进位的样本探测;探测只读不改写成员,多线程同时发送时由 mProbeMutex 串行化.
+     */
+    bool isStandardFrame() {
+        if (mFrameMode.load(std::memory_order_acquire) != FrameMode::Unknown) {
+            return mFrameMode.load(std::memory_order_relaxed) == FrameMode::Standard;
+        }
+        std::lock_guard<std::mutex> lock(mProbeMutex);
+        if (mFrameMode == FrameMode::Unknown) {
+            std::uint8_t address = mDeviceAddress;
+            bool standard = magic() == std::vector<uint8_t>{0xff, address};
+            for (const auto& sample : {std::vector<uint8_t>{0xff, 0x01, 0x00, 0x04, 0x20, 0x00},
+                                       std::vector<uint8_t>{0xff, 0xff, 0x88, 0x90, 0xa5, 0x5a},
+                                       std::vector<uint8_t>{0xff, 0x7f, 0x00, 0x4b, 0xff, 0xfe}}) {
+                standard = standard && checkSum(sample) == PelcoDFrame(sample[1], sample[2], sample[3], sample[4], sample[5]).bytes[6];
+            }
+            mFrameMode.store(standard ? FrameMode::Standard : FrameMode::Vendor, std::memory_order_release);
+        }
+        return mFrameMode == FrameMode::Standard;
+    }
+
 protected:
     /*!
     * 设备地址 0x01~0xff
     * 当然也可以使用 virtual std::uint8_t deviceAddress() {return 0x01;} 函数替代该成员变量,需要修改设备ID时继承该类重写该函数即可.
+    * 多个线程可同时发送指令,但修改地址(setAnyValue(0, ...))不能与发送并发进行.
     */
     std::uint8_t mDeviceAddress = 0x01;
     std::shared_ptr<PelcoDProtocolConfig> mConfig;
+    PelcoDFrameParser mParser;
+    PelcoDQueryTracker mQueries;
+    PelcoDStateCache mState;
+    PelcoDMotionEstimator mEstimator;
+
+private:
+    std::atomic<std::chrono::nanoseconds> mDelaySpin {std::chrono::nanoseconds(0)};
+    std::mutex mPulseMutex;
+    std::shared_ptr<PelcoDTimerWheel> mTimerWheel;
+    PelcoDTimerWheel::TimerId mPendingStop = 0;
+    std::uint64_t mPulseSequence = 0;
+
+    static constexpr std::uint8_t kInfraredAddress = 0x02;
+
+    enum class FrameMode : std::uint8_t
+    {
+        Unknown,
+        Standard,
+        Vendor
+    };
+    std::atomic<FrameMode> mFrameMode {FrameMode::Unknown};
+    std::mutex mProbeMutex;
+};
+
+/*!
+ * 批量编码的单条指令,布局与帧的 Byte 2~6 一致并补齐到 8 字节,便于向量化计算校验和.
+ */
+struct PelcoDBatchCommand {
+    PelcoDBatchCommand() = default;
+    PelcoDBatchCommand(std::uint8_t address, PelcoDCommand cmd, std::uint8_t data_1 = 0x00, std::uint8_t data_2 = 0x00)
+        : address(address)
+        , cmd_1(std::uint8_t(std::uint16_t(cmd) >> 8))
+        , cmd_2(std::uint8_t(std::uint16_t(cmd) & 0xff))
+        , data_1(data_1)
+        , data_2(data_2) {
+    }
+
+    std::uint8_t address = 0x00;
+    std::uint8_t cmd_1 = 0x00;
+    std::uint8_t cmd_2 = 0x00;
+    std::uint8_t data_1 = 0x00;
+    std::uint8_t data_2 = 0x00;
+    std::uint8_t reserve[3] = {0x00, 0x00, 0x00};// reserve
+};
+
+static_assert(sizeof(PelcoDBatchCommand) == 8, "PelcoDBatchCommand must stay 8 bytes for the vectorized checksum");
+
+/*!
+ * 批量编码器:把 (address, command, data) 序列编码为首尾相接的 7 字节帧,写入调用方提供的缓冲区,
+ * 适合对同一条总线上的大量设备下发同一动作后一次性写出.
+ * 校验和使用 SSE2/AVX2 的 _mm_sad_epu8 一次计算 2/4 条指令,无 SIMD 时使用标量实现.
+ * 仅适用于标准协议,非标厂家仍需逐条调用 SimplePelcoDProtocolImpl.
+ */
+class PelcoDBatchEncoder {
+public:
+    // 返回写入的帧数,缓冲区不足时只编码能容纳的部分
+    static std::size_t encode(const PelcoDBatchCommand* commands, std::size_t count, std::uint8_t* out, std::size_t capacity) {
+        count = std::min(count, capacity / PelcoDFrame::kSize);
+        std::size_t i = 0;
+#if defined(PELCOD_HAS_AVX2)
+        // 每次 4 条; 8 字节写入会覆盖下一帧的 Byte 1,因此要求后面至少还有一帧
+        const __m256i mask256 = _mm256_set1_epi64x(0x000000ffffffffffLL);
+        const __m256i sync256 = _mm256_set1_epi64x(0xff);
+        const __m256i low256 = _mm256_set1_epi64x(0xff);
+        for (; i + 4 < count; i += 4) {
+            __m256i cmd = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(commands + i)), mask256);
+            __m256i sum = _mm256_and_si256(_mm256_sad_epu8(cmd, _mm256_setzero_si256()), low256);
+            __m256i frame = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi64(cmd, 8), sync256), _mm256_slli_epi64(sum, 48));
+            storeFrames(_mm256_castsi256_si128(frame), out + i * PelcoDFrame::kSize);
+            storeFrames(_mm256_extracti128_si256(frame, 1), out + (i + 2) * PelcoDFrame::kSize);
+        }
+#endif
+#if defined(PELCOD_HAS_SSE2)
+        // 每次 2 条
+        const __m128i mask = _mm_set1_epi64x(0x000000ffffffffffLL);
+        const __m128i sync = _mm_set1_epi64x(0xff);
+        const __m128i low = _mm_set1_epi64x(0xff);
+        for (; i + 2 < count; i += 2) {
+            __m128i cmd = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(commands + i)), mask);
+            __m128i sum = _mm_and_si128(_mm_sad_epu8(cmd, _mm_setzero_si128()), low);
+            __m128i frame = _mm_or_si128(_mm_or_si128(_mm_slli_epi64(cmd, 8), sync), _mm_slli_epi64(sum, 48));
+            storeFrames(frame, out + i * PelcoDFrame::kSize);
+        }
+#endif
+        for (; i < count; ++i) {
+            const auto& cmd = commands[i];
+            PelcoDFrame frame(cmd.address, cmd.cmd_1, cmd.cmd_2, cmd.data_1, cmd.data_2);
+            std::memcpy(out + i * PelcoDFrame::kSize, frame.data(), PelcoDFrame::kSize);
+        }
+        return count;
+    }
+    static std::size_t encode(const std::vector<PelcoDBatchCommand>& commands, std::uint8_t* out, std::size_t capacity) {
+        return encode(commands.data(), commands.size(), out, capacity);
+    }
+
+    // 向多个地址下发同一指令,例如对整条总线 stopMotion / callPreset(N)
+    static std::size_t broadcast(const std::uint8_t* addresses, std::size_t count, PelcoDCommand cmd, std::uint8_t data_1, std::uint8_t data_2, std::uint8_t* out, std::size_t capacity) {
+        const std::size_t kChunk = 64;
+        PelcoDBatchCommand commands[kChunk];
+        std::size_t written = 0;
+        for (std::size_t i = 0; i < count; i += kChunk) {
+            auto n = std::min(kChunk, count - i);
+            for (std::size_t j = 0; j < n; ++j) {
+                commands[j] = PelcoDBatchCommand(addresses[i + j], cmd, data_1, data_2);
+            }
+            auto done = encode(commands, n, out + written * PelcoDFrame::kSize, capacity - written * PelcoDFrame::kSize);
+            written += done;
+            if (done != n) {
+                break;
+            }
+        }
+        return written;
+    }
+
+private:
+#if defined(PELCOD_HAS_SSE2)
+    // 两帧各写 8 字节,后一次写入覆盖前一帧多出的 1 字节
+    static void storeFrames(__m128i frames, std::uint8_t* out) {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), frames);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + PelcoDFrame::kSize), _mm_unpackhi_epi64(frames, frames));
+    }
+#endif
+};
+
+/*!
+ * 批量帧校验,对应 doc/PelcoDProtocol.cpp 中 PelcoDProtocol::isValid 的批量版本.
+ * 输入为首尾相接的 7 字节帧,逐帧检查同步字节 0xff、地址(可选)与校验和,
+ * 返回合法帧数量,bitmap 不为空时第 i 位表示第 i 帧是否合法(需 (count + 63) / 64 个元素).
+ * SSE2 每次校验 2 帧,AVX2 每次 4 帧,其余使用标量实现.
+ */
+class PelcoDFrameValidator {
+public:
+    // 单帧校验
+    static bool isValid(const std::uint8_t* raw, std::size_t len) {
+        if (len != PelcoDFrame::kSize || raw[0] != 0xff) {
+            return false;
+        }
+        return std::uint8_t(raw[1] + raw[2] + raw[3] + raw[4] + raw[5]) == raw[6];
+    }
+
+    // 不过滤地址
+    static std::size_t validate(const std::uint8_t* frames, std::size_t count, std::uint64_t* bitmap = nullptr) {
+        return validate(frames, count, 0x00ff, 0x00ff, bitmap);
+    }
+    // 仅接受发往/来自 address 的帧
+    static std::size_t validate(const std::uint8_t* frames, std::size_t count, std::uint8_t address, std::uint64_t* bitmap = nullptr) {
+        return validate(frames, count, 0xffff, std::uint16_t(0xff | address << 8), bitmap);
+    }
+
+private:
+    // 帧的 Byte 1~2 与 key_mask 相与后须等于 key
+    static std::size_t validate(const std::uint8_t* frames, std::size_t count, std::uint16_t key_mask, std::uint16_t key, std::uint64_t* bitmap) {
+        std::size_t valid = 0;
+        std::uint64_t word = 0;
+        std::size_t i = 0;
+        // 8 字节读取会越过当前帧 1 字节,因此向量循环要求后面至少还有一帧
+#if defined(PELCOD_HAS_AVX2)
+        const __m256i key_mask256 = _mm256_set1_epi64x(key_mask);
+        const __m256i key256 = _mm256_set1_epi64x(key);
+        const __m256i sum_mask256 = _mm256_set1_epi64x(0x0000ffffffffff00LL);
+        const __m256i low256 = _mm256_set1_epi64x(0xff);
+        for (; i + 4 < count; i += 4) {
+            const std::uint8_t* p = frames + i * PelcoDFrame::kSize;
+            __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(loadFrames(p)), loadFrames(p + 2 * PelcoDFrame::kSize), 1);
+            __m256i sum = _mm256_sad_epu8(_mm256_and_si256(v, sum_mask256), _mm256_setzero_si256());
+            __m256i diff = _mm256_and_si256(_mm256_sub_epi64(sum, _mm256_srli_epi64(v, 48)), low256);
+            __m256i r = _mm256_or_si256(_mm256_xor_si256(_mm256_and_si256(v, key_mask256), key256), _mm256_slli_epi64(diff, 16));
+            // r 只占用每个 64 位元素的低 32 位,该 32 位为 0 即合法
+            unsigned ok = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi32(r, _mm256_setzero_si256())));
+            for (unsigned lane = 0; lane < 4; ++lane) {
+                if (((ok >> (lane * 8)) & 0xf) == 0xf) {
+                    ++valid;
+                    word |= std::uint64_t(1) << ((i + lane) & 63);
+                }
+            }
+            flush(bitmap, i + 4, word);
+        }
+#endif
+#if defined(PELCOD_HAS_SSE2)
+        const __m128i key_mask128 = _mm_set1_epi64x(key_mask);
+        const __m128i key128 = _mm_set1_epi64x(key);
+        const __m128i sum_mask128 = _mm_set1_epi64x(0x0000ffffffffff00LL);
+        const __m128i low128 = _mm_set1_epi64x(0xff);
+        for (; i + 2 < count; i += 2) {
+            __m128i v = loadFrames(frames + i * PelcoDFrame::kSize);
+            __m128i sum = _mm_sad_epu8(_mm_and_si128(v, sum_mask128), _mm_setzero_si128());
+            __m128i diff = _mm_and_si128(_mm_sub_epi64(sum, _mm_srli_epi64(v, 48)), low128);
+            __m128i r = _mm_or_si128(_mm_xor_si128(_mm_and_si128(v, key_mask128), key128), _mm_slli_epi64(diff, 16));
+            unsigned ok = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi32(r, _mm_setzero_si128())));
+            for (unsigned lane = 0; lane < 2; ++lane) {
+                if (((ok >> (lane * 8)) & 0xf) == 0xf) {
+                    ++valid;
+                    word |= std::uint64_t(1) << ((i + lane) & 63);
+                }
+            }
+            flush(bitmap, i + 2, word);
+        }
+#endif
+        for (; i < count; ++i) {
+            const std::uint8_t* p = frames + i * PelcoDFrame::kSize;
+            if (isValid(p, PelcoDFrame::kSize) && (std::uint16_t(p[0] | p[1] << 8) & key_mask) == key) {
+                ++valid;
+                word |= std::uint64_t(1) << (i & 63);
+            }
+            flush(bitmap, i + 1, word);
+        }
+        if (bitmap && (count & 63) != 0) {
+            bitmap[count / 64] = word;
+        }
+        return valid;
+    }
+
+    // 已处理 done 帧,写满 64 位时输出
+    static void flush(std::uint64_t* bitmap, std::size_t done, std::uint64_t& word) {
+        if ((done & 63) == 0) {
+            if (bitmap) {
+                bitmap[done / 64 - 1] = word;
+            }
+            word = 0;
+        }
+    }
+
+#if defined(PELCOD_HAS_SSE2)
+    // 相邻两帧各读取 8 字节,分别放入低/高 64 位
+    static __m128i loadFrames(const std::uint8_t* p) {
+        return _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + PelcoDFrame::kSize)));
+    }
+#endif
 };
 
 class SimplePelcoDDecorator : public SimplePelcoDProtocol {
@@ -997,6 +3095,18 @@ public:
     virtual void queryMagnificationResponse(std::uint8_t pos) override {
         this->mComponent->queryMagnificationResponse(pos);
     }
+    virtual void queryPanPositionResponse16(std::uint16_t pos) override {
+        this->mComponent->queryPanPositionResponse16(pos);
+    }
+    virtual void queryTiltPositionResponse16(std::uint16_t pos) override {
+        this->mComponent->queryTiltPositionResponse16(pos);
+    }
+    virtual void queryZoomPositionResponse16(std::uint16_t pos) override {
+        this->mComponent->queryZoomPositionResponse16(pos);
+    }
+    virtual void queryMagnificationResponse16(std::uint16_t pos) override {
+        this->mComponent->queryMagnificationResponse16(pos);
+    }
 
     // 用于各种奇葩的厂家扩展
     virtual void setAnyValue(std::uint8_t type, const std::any& value) override {
@@ -1010,6 +3120,12 @@ public:
     virtual void sendRawCmd(const std::vector<std::uint8_t>& data) override {
         this->mComponent->sendRawCmd(data);
     }
+    virtual void sendRawCmd(PelcoDByteView data) override {
+        this->mComponent->sendRawCmd(data);
+    }
+    virtual void sendRawCmd(std::vector<std::uint8_t>&& data) override {
+        this->mComponent->sendRawCmd(std::move(data));
+    }
 
     // 红外摄像头放大/缩小
     virtual void infraredZoomIn() override {
@@ -1130,6 +3246,62 @@ public:
     }
 };
 
+/*!
+ * 编译期装饰器栈,与运行期的 SimplePelcoDDecorator 链作用相同,但各层在编译期展开,可以完全内联.
+ * 每一层是 template <typename Next> class Layer : public Next,重写需要拦截的公有函数并调用 Next::xxx.
+ * Layers 中第一个为最外层:
+ *
+ * using Ptz = PelcoDDecoratorStack<BasicPelcoDProtocol<MySerial>, Logging, RateLimit, Metrics>;
+ *
+ * Core 为 BasicPelcoDProtocol 时各层均为普通函数,Core 的 CRTP 类型被替换为整个栈,
+ * 指令集内部发起的调用(single* 发出的停止、16 位/浮点便捷重载)同样经过每一层;
+ * Core 为 SimplePelcoDProtocolImpl 时各层函数即为虚函数重写,得到的类型仍是 SimplePelcoDProtocol,
+ * 可以继续交给运行期装饰器或插件使用.
+ */
+template <typename Core, typename Stack>
+struct PelcoDDecoratorCore {
+    using type = Core;
+};
+
+template <typename Transport, typename Header, typename Checksum, typename Stack>
+struct PelcoDDecoratorCore<BasicPelcoDProtocol<Transport, Header, Checksum>, Stack> {
+    using type = BasicPelcoDProtocol<Transport, Header, Checksum, Stack>;
+};
+
+template <typename Core, template <typename> class... Layers>
+struct PelcoDDecoratorStackBuilder;
+
+template <typename Core>
+struct PelcoDDecoratorStackBuilder<Core> {
+    using type = Core;
+};
+
+template <typename Core, template <typename> class Layer, template <typename> class... Rest>
+struct PelcoDDecoratorStackBuilder<Core, Layer, Rest...> {
+    using type = Layer<typename PelcoDDecoratorStackBuilder<Core, Rest...>::type>;
+};
+
+template <typename Core, template <typename> class... Layers>
+class PelcoDDecoratorStack
+    : public PelcoDDecoratorStackBuilder<typename PelcoDDecoratorCore<Core, PelcoDDecoratorStack<Core, Layers...>>::type, Layers...>::type {
+    using Base = typename PelcoDDecoratorStackBuilder<typename PelcoDDecoratorCore<Core, PelcoDDecoratorStack<Core, Layers...>>::type, Layers...>::type;
+
+public:
+    using Base::Base;
+};
+
+// 与 SimplePelcoDDecoratorA 对应的编译期装饰层
+template <typename Next>
+class PelcoDDecoratorLayerA : public Next {
+public:
+    using Next::Next;
+
+    void stopMotion(void) {
+        std::cout << "call void stopMotion(void) function" << std::endl;
+        Next::stopMotion();
+    }
+};
+
 class ExampleAttachObject : public PelcoDProtocolConfig {
 public:
     virtual std::string ip() const override {
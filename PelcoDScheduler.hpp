@@ -0,0 +1,551 @@
+#ifndef PELCODSCHEDULER_HPP
+#define PELCODSCHEDULER_HPP
+
+#include "PelcoDProtocol.hpp"
+
+#include <memory>
+
+/*!
+ * RS-485 多点总线调度
+ *
+ * 半双工总线上同一时刻只能有一个帧在线路上,多个设备地址共享同一条线路.
+ * PelcoDBusScheduler 独占线路:按波特率计算每帧的线上时间,在线路空闲时才发出下一帧,
+ * 各地址之间轮转发送保证公平,查询帧发出后为响应预留窗口,响应到达后提前结束窗口.
+ * 帧按优先级分类:停止指令插队到最前并丢弃同一地址尚未发出的连续运动帧,其次是运动控制,最后是查询、预置位与绝对位置.
+ * 连续运动帧后到者覆盖尚未发出的同地址运动帧,每个地址最多排队一个,摇杆高频调用时不会积压.
+ * 可选地跳过与该地址上次发出的帧完全相同的重复帧,超过刷新间隔后照常重发,以弥补线路上丢失的帧.
+ * 排队中的帧存放在定长内存池 PelcoDFramePool 中,稳定运行后排队与发送不再分配内存.
+ * 调度器本身不涉及 I/O 与定时器,由 poll() 驱动,参见 PelcoDTransport.hpp 中的 PelcoDBus.
+ */
+
+// 线路参数,默认 2400 8N1
+struct PelcoDBusTiming {
+    std::uint32_t baudRate = 2400;
+    std::uint8_t dataBits = 8;
+    bool parity = false;
+    std::uint8_t stopBits = 1;
+    // 帧间保护间隔
+    std::chrono::microseconds guard {0};
+    // 设备收到查询到开始回送响应的时间
+    std::chrono::microseconds turnaround {5000};
+
+    // 每个字节:起始位 + 数据位 + 校验位 + 停止位
+    std::uint32_t bitsPerByte() const {
+        return 1u + dataBits + (parity ? 1u : 0u) + stopBits;
+    }
+    // 一帧 7 字节在线路上占用的时间
+    std::chrono::microseconds frameTime() const {
+        return std::chrono::microseconds((std::uint64_t(PelcoDFrame::kSize) * bitsPerByte() * 1000000u + baudRate - 1) / baudRate);
+    }
+    // 查询帧发出后为响应预留的时间
+    std::chrono::microseconds responseWindow() const {
+        return turnaround + frameTime();
+    }
+};
+
+// 需要等待设备响应的指令
+constexpr bool pelcoDExpectsResponse(PelcoDCommand command) {
+    return command == PelcoDCommand::QueryPanPosition || command == PelcoDCommand::QueryTiltPosition
+        || command == PelcoDCommand::QueryZoomPosition || command == PelcoDCommand::QueryMagnification;
+}
+
+// 发送优先级,数值越小越先发送
+enum class PelcoDPriority : std::uint8_t
+{
+    // 停止与安全指令
+    Stop,
+    // 连续运动等实时控制
+    Motion,
+    // 查询、预置位、绝对位置等扩展指令
+    Deferred,
+    Count,
+};
+
+constexpr PelcoDPriority pelcoDPriority(std::uint8_t cmd_1, std::uint8_t cmd_2) {
+    if (cmd_1 == 0x00 && cmd_2 == 0x00) {
+        return PelcoDPriority::Stop;
+    }
+    // 扩展指令 Command 2 的 Bit 0 为 1
+    return (cmd_2 & 0x01) ? PelcoDPriority::Deferred : PelcoDPriority::Motion;
+}
+constexpr PelcoDPriority pelcoDPriority(PelcoDCommand command) {
+    return pelcoDPriority(std::uint8_t(std::uint16_t(command) >> 8), std::uint8_t(std::uint16_t(command) & 0xff));
+}
+
+// 连续运动:平移/倾斜/变倍/聚焦/光圈,不含 Sense/Scan/Camera 等开关类标准指令
+constexpr bool pelcoDIsContinuousMotion(std::uint8_t cmd_1, std::uint8_t cmd_2) {
+    return pelcoDPriority(cmd_1, cmd_2) == PelcoDPriority::Motion && (cmd_1 & 0x98) == 0;
+}
+
+static_assert(pelcoDPriority(PelcoDCommand::Stop) == PelcoDPriority::Stop, "stop must preempt");
+static_assert(pelcoDPriority(PelcoDCommand::Left | PelcoDCommand::Up) == PelcoDPriority::Motion, "motion");
+static_assert(pelcoDPriority(PelcoDCommand::CallPreset) == PelcoDPriority::Deferred, "preset");
+static_assert(pelcoDPriority(PelcoDCommand::QueryPanPosition) == PelcoDPriority::Deferred, "query");
+static_assert(pelcoDIsContinuousMotion(0x02, 0x00) && !pelcoDIsContinuousMotion(0x88, 0x00), "camera on is not motion");
+
+struct PelcoDBusStats {
+    std::uint64_t frames = 0;
+    std::uint64_t queries = 0;
+    std::uint64_t responses = 0;
+    // 响应窗口结束仍未收到响应
+    std::uint64_t responseTimeouts = 0;
+    // 被停止指令作废而未发送的连续运动帧
+    std::uint64_t preempted = 0;
+    // 被同地址更新的运动帧覆盖而未发送的帧
+    std::uint64_t coalesced = 0;
+    // 与上次发出的帧相同而跳过的帧,及因此节省的线路时间
+    std::uint64_t suppressed = 0;
+    std::chrono::microseconds saved {0};
+    // 帧与响应窗口占用线路的累计时间
+    std::chrono::microseconds busy {0};
+};
+
+/*!
+ * 排队帧的定长内存池.每个槽位 16 字节(一帧加一个链表指针),按 256 个槽位一块向系统申请,申请后不再归还.
+ * 每个线程缓存一组空闲槽位,取用与归还通常不加锁;缓存空了从全局链表成批取 kBatch 个,
+ * 缓存过多时成批归还,生产者线程取用、事件循环线程归还的常见情形下稳定运行后不再调用 malloc.
+ * 线程退出时其缓存归还全局链表.
+ */
+class PelcoDFramePool {
+public:
+    struct Slot {
+        PelcoDFrame frame;
+        Slot* next = nullptr;
+    };
+    static_assert(sizeof(Slot) <= 16, "pelco-d frame pool slots are 16 bytes");
+
+    static constexpr std::size_t kSlabSlots = 256;
+    static constexpr std::size_t kBatch = 32;
+
+    // 进程内唯一,刻意不析构,避免线程缓存在静态对象析构之后归还
+    static PelcoDFramePool& instance() {
+        static PelcoDFramePool* pool = new PelcoDFramePool();
+        return *pool;
+    }
+
+    Slot* acquire(const PelcoDFrame& frame) {
+        Cache& local = cache();
+        if (local.head == nullptr) {
+            refill(local);
+        }
+        Slot* slot = local.head;
+        local.head = slot->next;
+        --local.count;
+        slot->frame = frame;
+        slot->next = nullptr;
+        return slot;
+    }
+    void release(Slot* slot) {
+        Cache& local = cache();
+        slot->next = local.head;
+        local.head = slot;
+        if (++local.count >= 2 * kBatch) {
+            spill(local, kBatch);
+        }
+    }
+    // 已向系统申请的槽位数
+    std::size_t capacity() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mSlabs.size() * kSlabSlots;
+    }
+
+private:
+    struct Cache {
+        Slot* head = nullptr;
+        std::size_t count = 0;
+        ~Cache() {
+            PelcoDFramePool::instance().spill(*this, count);
+        }
+    };
+
+    PelcoDFramePool() = default;
+
+    static Cache& cache() {
+        thread_local Cache local;
+        return local;
+    }
+    void refill(Cache& local) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mFree == nullptr) {
+            mSlabs.emplace_back(new Slot[kSlabSlots]);
+            Slot* slab = mSlabs.back().get();
+            for (std::size_t i = 0; i < kSlabSlots; ++i) {
+                slab[i].next = mFree;
+                mFree = &slab[i];
+            }
+        }
+        while (mFree != nullptr && local.count < kBatch) {
+            Slot* slot = mFree;
+            mFree = slot->next;
+            slot->next = local.head;
+            local.head = slot;
+            ++local.count;
+        }
+    }
+    void spill(Cache& local, std::size_t count) {
+        if (count == 0) {
+            return;
+        }
+        // 先在锁外摘下一段,再整段接入全局链表
+        Slot* first = local.head;
+        Slot* last = first;
+        for (std::size_t i = 1; i < count; ++i) {
+            last = last->next;
+        }
+        local.head = last->next;
+        local.count -= count;
+        std::lock_guard<std::mutex> lock(mMutex);
+        last->next = mFree;
+        mFree = first;
+    }
+
+    mutable std::mutex mMutex;
+    Slot* mFree = nullptr;
+    std::vector<std::unique_ptr<Slot[]>> mSlabs;
+};
+
+// 由 PelcoDFramePool 槽位串成的先进先出队列,非线程安全
+class PelcoDFrameQueue {
+public:
+    PelcoDFrameQueue() = default;
+    PelcoDFrameQueue(const PelcoDFrameQueue&) = delete;
+    PelcoDFrameQueue& operator=(const PelcoDFrameQueue&) = delete;
+    PelcoDFrameQueue(PelcoDFrameQueue&& other) noexcept
+        : mHead(std::exchange(other.mHead, nullptr))
+        , mTail(std::exchange(other.mTail, nullptr))
+        , mSize(std::exchange(other.mSize, 0)) {
+    }
+    ~PelcoDFrameQueue() {
+        clear();
+    }
+
+    bool empty() const {
+        return mHead == nullptr;
+    }
+    std::size_t size() const {
+        return mSize;
+    }
+    PelcoDFrame& front() {
+        return mHead->frame;
+    }
+    void push_back(const PelcoDFrame& frame) {
+        PelcoDFramePool::Slot* slot = PelcoDFramePool::instance().acquire(frame);
+        if (mTail != nullptr) {
+            mTail->next = slot;
+        } else {
+            mHead = slot;
+        }
+        mTail = slot;
+        ++mSize;
+    }
+    void pop_front() {
+        PelcoDFramePool::Slot* slot = mHead;
+        mHead = slot->next;
+        if (mHead == nullptr) {
+            mTail = nullptr;
+        }
+        --mSize;
+        PelcoDFramePool::instance().release(slot);
+    }
+    void clear() {
+        while (mHead != nullptr) {
+            pop_front();
+        }
+    }
+    // 返回第一个满足 predicate 的帧,没有时返回 nullptr
+    template <typename Predicate>
+    PelcoDFrame* find(Predicate&& predicate) {
+        for (auto slot = mHead; slot != nullptr; slot = slot->next) {
+            if (predicate(slot->frame)) {
+                return &slot->frame;
+            }
+        }
+        return nullptr;
+    }
+    // 移除所有满足 predicate 的帧,其余帧保持原有顺序,返回移除的个数
+    template <typename Predicate>
+    std::size_t remove_if(Predicate&& predicate) {
+        std::size_t removed = 0;
+        PelcoDFramePool::Slot* previous = nullptr;
+        for (auto slot = mHead; slot != nullptr;) {
+            auto next = slot->next;
+            if (predicate(slot->frame)) {
+                (previous != nullptr ? previous->next : mHead) = next;
+                if (slot == mTail) {
+                    mTail = previous;
+                }
+                PelcoDFramePool::instance().release(slot);
+                ++removed;
+            } else {
+                previous = slot;
+            }
+            slot = next;
+        }
+        mSize -= removed;
+        return removed;
+    }
+
+private:
+    PelcoDFramePool::Slot* mHead = nullptr;
+    PelcoDFramePool::Slot* mTail = nullptr;
+    std::size_t mSize = 0;
+};
+
+/*!
+ * 总线调度器,线程安全.
+ * submit 可在任意线程调用;poll 由持有线路的一方(通常是事件循环)调用,把到期的帧交给 sink 写入线路.
+ * 高优先级的帧总是先于低优先级的帧发出,同一优先级内各地址轮转;正在进行的帧与响应窗口不会被打断.
+ */
+class PelcoDBusScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PelcoDBusScheduler(const PelcoDBusTiming& timing = {})
+        : mTiming(timing) {
+    }
+
+    void setTiming(const PelcoDBusTiming& timing) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTiming = timing;
+    }
+    PelcoDBusTiming timing() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mTiming;
+    }
+    // 连续运动帧是否后到覆盖,默认开启
+    void setCoalesceMotion(bool coalesce) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCoalesceMotion = coalesce;
+    }
+    /*!
+     * 跳过重复帧:同一地址在 refresh 时间内再次发送相同的帧时不上线路,查询帧除外.
+     * refresh 同时是强制刷新间隔,距上次实际发出超过该时间的相同帧照常发送;0 表示关闭(默认).
+     */
+    void setSuppressDuplicates(std::chrono::microseconds refresh) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRefresh = refresh;
+    }
+
+    // 排队一帧,地址取自 Byte 2,优先级取自 Byte 3~4
+    void submit(const PelcoDFrame& frame) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::uint8_t address = frame.bytes[1];
+        PelcoDPriority priority = pelcoDPriority(frame.bytes[2], frame.bytes[3]);
+        Device& device = mDevices[address];
+        if (priority == PelcoDPriority::Stop) {
+            // 停止之前排队的连续运动已无意义;Camera On/Off、Sense、Scan 等开关类指令照常按序发送
+            mStats.preempted += device.queue(PelcoDPriority::Motion).remove_if([](const PelcoDFrame& item) {
+                return pelcoDIsContinuousMotion(item.bytes[2], item.bytes[3]);
+            });
+        } else if (mCoalesceMotion && pelcoDIsContinuousMotion(frame.bytes[2], frame.bytes[3])) {
+            // 原位替换,保留已排到的轮转位置
+            auto queued = device.queue(PelcoDPriority::Motion).find([](const PelcoDFrame& item) {
+                return pelcoDIsContinuousMotion(item.bytes[2], item.bytes[3]);
+            });
+            if (queued != nullptr) {
+                *queued = frame;
+                ++mStats.coalesced;
+                return;
+            }
+        }
+        device.queue(priority).push_back(frame);
+        activate(address, device, priority);
+    }
+    void submit(PelcoDByteView frame) {
+        if (frame.size() != PelcoDFrame::kSize) {
+            throw std::invalid_argument("pelco-d bus frames must be 7 bytes");
+        }
+        PelcoDFrame copy;
+        std::copy(frame.begin(), frame.end(), copy.bytes.begin());
+        submit(copy);
+    }
+
+    /*!
+     * 线路空闲时按地址轮转发出一帧,sink(const PelcoDFrame&) 负责写入线路.
+     * 返回下次需要调用的时间;没有待发帧时返回 time_point::max().
+     * 一次调用最多发出一帧,帧的线上时间结束之前线路视为占用.
+     */
+    template <typename Sink>
+    Clock::time_point poll(Sink&& sink, Clock::time_point now = Clock::now()) {
+        PelcoDFrame frame;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (now < mBusyUntil) {
+                return idle() && !mAwaiting ? Clock::time_point::max() : mBusyUntil;
+            }
+            if (mAwaiting) {
+                mAwaiting = false;
+                ++mStats.responseTimeouts;
+            }
+            std::uint8_t address = 0;
+            bool query = false;
+            do {
+                if (!next(frame)) {
+                    return Clock::time_point::max();
+                }
+                address = frame.bytes[1];
+                query = pelcoDExpectsResponse(PelcoDFrameView(frame.data()).command());
+            } while (!query && duplicate(mDevices[address], frame, now));
+
+            auto occupied = mTiming.frameTime() + mTiming.guard;
+            ++mStats.frames;
+            if (query) {
+                ++mStats.queries;
+                occupied += mTiming.responseWindow();
+                mAwaiting = true;
+                mAwaitAddress = address;
+            }
+            mStats.busy += occupied;
+            mBusyUntil = now + occupied;
+        }
+        sink(frame);
+        return mBusyUntil;
+    }
+
+    // 收到 address 的响应,提前结束为其预留的响应窗口
+    void responseReceived(std::uint8_t address, Clock::time_point now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mAwaiting || mAwaitAddress != address) {
+            return;
+        }
+        mAwaiting = false;
+        ++mStats.responses;
+        auto release = now + mTiming.guard;
+        if (release < mBusyUntil) {
+            mStats.busy -= std::chrono::duration_cast<std::chrono::microseconds>(mBusyUntil - release);
+            mBusyUntil = release;
+        }
+    }
+
+    // 线路被占用到何时
+    Clock::time_point busyUntil() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mBusyUntil;
+    }
+    std::size_t pending() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::size_t count = 0;
+        for (const auto& item : mDevices) {
+            count += item.second.size();
+        }
+        return count;
+    }
+    std::size_t pending(std::uint8_t address) const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mDevices.find(address);
+        return it == mDevices.end() ? 0 : it->second.size();
+    }
+    PelcoDBusStats stats() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+private:
+    static constexpr std::size_t kPriorities = std::size_t(PelcoDPriority::Count);
+
+    struct Device {
+        std::array<PelcoDFrameQueue, kPriorities> frames;
+        // 是否已在对应优先级的轮转队列中
+        std::array<bool, kPriorities> active {};
+        // 上次实际发出的非查询帧
+        PelcoDFrame last;
+        Clock::time_point lastSent {};
+        bool hasLast = false;
+
+        PelcoDFrameQueue& queue(PelcoDPriority priority) {
+            return frames[std::size_t(priority)];
+        }
+        std::size_t size() const {
+            std::size_t count = 0;
+            for (const auto& queue : frames) {
+                count += queue.size();
+            }
+            return count;
+        }
+    };
+
+    // 每个地址在同一优先级中至多出现一次,256 个位置的环形队列足够
+    struct ActiveRing {
+        std::array<std::uint8_t, 256> addresses {};
+        std::uint8_t head = 0;
+        std::size_t count = 0;
+
+        bool empty() const {
+            return count == 0;
+        }
+        void push_back(std::uint8_t address) {
+            addresses[std::uint8_t(head + count)] = address;
+            ++count;
+        }
+        std::uint8_t pop_front() {
+            --count;
+            return addresses[head++];
+        }
+    };
+
+    void activate(std::uint8_t address, Device& device, PelcoDPriority priority) {
+        if (!device.active[std::size_t(priority)]) {
+            device.active[std::size_t(priority)] = true;
+            mActive[std::size_t(priority)].push_back(address);
+        }
+    }
+    // 取出最高优先级中轮到的地址的下一帧;被停止指令清空的队列在此跳过
+    bool next(PelcoDFrame& frame) {
+        for (std::size_t priority = 0; priority < kPriorities; ++priority) {
+            auto& active = mActive[priority];
+            while (!active.empty()) {
+                std::uint8_t address = active.pop_front();
+                Device& device = mDevices[address];
+                auto& queue = device.frames[priority];
+                device.active[priority] = false;
+                if (queue.empty()) {
+                    continue;
+                }
+                frame = queue.front();
+                queue.pop_front();
+                if (!queue.empty()) {
+                    activate(address, device, PelcoDPriority(priority));
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+    // 与上次发出的帧相同且仍在刷新间隔内时跳过,否则记为上次发出的帧
+    bool duplicate(Device& device, const PelcoDFrame& frame, Clock::time_point now) {
+        if (mRefresh.count() <= 0) {
+            return false;
+        }
+        if (device.hasLast && device.last.bytes == frame.bytes && now - device.lastSent < mRefresh) {
+            ++mStats.suppressed;
+            mStats.saved += mTiming.frameTime() + mTiming.guard;
+            return true;
+        }
+        device.last = frame;
+        device.lastSent = now;
+        device.hasLast = true;
+        return false;
+    }
+    bool idle() const {
+        for (const auto& active : mActive) {
+            if (!active.empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    mutable std::mutex mMutex;
+    PelcoDBusTiming mTiming;
+    std::unordered_map<std::uint8_t, Device> mDevices;
+    // 各优先级中有待发帧的地址,按轮转顺序排列
+    std::array<ActiveRing, kPriorities> mActive;
+    Clock::time_point mBusyUntil {};
+    bool mCoalesceMotion = true;
+    std::chrono::microseconds mRefresh {0};
+    bool mAwaiting = false;
+    std::uint8_t mAwaitAddress = 0;
+    PelcoDBusStats mStats;
+};
+
+#endif // PELCODSCHEDULER_HPP
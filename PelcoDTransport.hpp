@@ -0,0 +1,2690 @@
+#ifndef PELCODTRANSPORT_HPP
+#define PELCODTRANSPORT_HPP
+
+#include "PelcoDProtocol.hpp"
+#include "PelcoDScheduler.hpp"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <condition_variable>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        #include <sys/mman.h>
+        #include <sys/syscall.h>
+        #if defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+            #define PELCOD_HAS_IO_URING 1
+        #endif
+    #endif
+#endif
+
+/*!
+ * Linux 传输层
+ *
+ * PelcoDReactor  :事件循环,一个线程即可服务成百上千个串口/网络连接,提供 post/schedule 供其他线程投递任务
+ * PelcoDChannel  :一个非阻塞文件描述符,线程安全的发送缓冲区,内核缓冲区满时排队待可写后继续发送
+ * PelcoDSerialPort:termios 配置的串口通道,同时满足 BasicPelcoDProtocol 的 Transport 要求
+ * PelcoDSerialProtocol:基于 PelcoDSerialPort 实现 sendData/connect/disconnect/isConnected 的 SimplePelcoDProtocolImpl
+ * PelcoDTcpChannel:串口服务器(RS-485 转以太网)的 TCP 连接,后台自动重连,合并写
+ * PelcoDTcpProtocol:基于 PelcoDTcpChannel 并使用 config()->ip()/port() 的 SimplePelcoDProtocolImpl
+ * PelcoDBus       :一条 RS-485 总线(串口或串口服务器连接),由 PelcoDBusScheduler 调度多个设备的发送,按地址分发响应
+ * PelcoDBusProtocol:挂在 PelcoDBus 上的一个设备
+ * PelcoDUringReactor:可选的 io_uring 后端,批量提交写请求并保持 multishot 接收;makePelcoDReactor() 不可用时回退到 epoll
+ * PelcoDFleet     :大规模部署,多条总线分片到若干工作线程,按摄像机 ID 路由并在线程间迁移总线
+ *
+ * PelcoDEpollReactor reactor;
+ * std::thread loop([&] { reactor.run(); });
+ * PelcoDSerialProtocol ptz(reactor, "/dev/ttyUSB0", {2400});
+ * ptz.connect();
+ * ptz.panLeft(0x20);
+ */
+
+class PelcoDReactor;
+
+/*!
+ * 有界无锁多生产者单消费者队列,元素为完整的 7 字节帧(Vyukov 有界队列).
+ * 每个槽带序号:生产者 CAS 递增尾指针占位,写入帧后发布序号;消费者按序号判断槽是否就绪,无需 CAS.
+ * 消费端同一时刻只能有一个线程,PelcoDChannel 中由持有通道锁者充当.
+ */
+class PelcoDFrameRing {
+public:
+    // capacity 向上取整为 2 的幂
+    explicit PelcoDFrameRing(std::size_t capacity = 256) {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mMask = size - 1;
+        mCells.reset(new Cell[size]);
+        for (std::size_t i = 0; i < size; ++i) {
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    PelcoDFrameRing(const PelcoDFrameRing&) = delete;
+    PelcoDFrameRing& operator=(const PelcoDFrameRing&) = delete;
+
+    std::size_t capacity() const {
+        return mMask + 1;
+    }
+    // 生产者已占用的位置总数,消费者据此等待已占位但尚未写完的生产者
+    std::size_t claimed() const {
+        return mTail.load(std::memory_order_acquire);
+    }
+    std::size_t consumed() const {
+        return mHead;
+    }
+    // 任意线程调用,队列满时返回 false
+    bool push(const PelcoDFrame& frame) {
+        std::size_t position = mTail.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &mCells[position & mMask];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = std::ptrdiff_t(sequence) - std::ptrdiff_t(position);
+            if (diff == 0) {
+                if (mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = mTail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->frame = frame;
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+    // 仅消费者调用,队列空(或队首的生产者尚未写完)时返回 false
+    bool pop(PelcoDFrame& frame) {
+        Cell& cell = mCells[mHead & mMask];
+        if (cell.sequence.load(std::memory_order_acquire) != mHead + 1) {
+            return false;
+        }
+        frame = cell.frame;
+        cell.sequence.store(mHead + mMask + 1, std::memory_order_release);
+        ++mHead;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        PelcoDFrame frame;
+    };
+
+    std::unique_ptr<Cell[]> mCells;
+    std::size_t mMask = 0;
+    // 生产者与消费者的指针分处不同缓存行,避免伪共享
+    alignas(64) std::atomic<std::size_t> mTail {0};
+    alignas(64) std::size_t mHead = 0;
+};
+
+class PelcoDChannel {
+public:
+    using Receiver = std::function<void(PelcoDByteView)>;
+
+    explicit PelcoDChannel(PelcoDReactor& reactor)
+        : mReactor(&reactor) {
+    }
+    PelcoDChannel(const PelcoDChannel&) = delete;
+    PelcoDChannel& operator=(const PelcoDChannel&) = delete;
+    // 派生类须在自身析构函数中调用 close(),否则事件循环可能回调到已析构的派生部分
+    virtual ~PelcoDChannel() {
+        close();
+    }
+
+    PelcoDReactor& reactor() {
+        return *mReactor.load(std::memory_order_acquire);
+    }
+    // 收到的数据在事件循环线程中交给 receiver;替换后如需确保旧的 receiver 不再被调用,再调用 reactor().quiesce()
+    void setReceiver(Receiver receiver) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReceiver = std::move(receiver);
+    }
+    bool isOpen() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFd >= 0;
+    }
+    // 非阻塞 connect 尚未完成
+    bool isConnecting() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFd >= 0 && mConnecting;
+    }
+    /*!
+     * 把通道迁移到另一个事件循环,描述符、发送缓冲区与无锁队列中的帧保持不变.
+     * 迁移期间 submit/write 只排队,不丢弃也不乱序;原事件循环结束当前这一轮后,通道才登记到 target.
+     * 可在任意线程调用(包括原事件循环线程);定时器等由调用者自行迁移,参见 PelcoDBus::moveTo.
+     * io_uring 后端在途的读取会被取消,其中尚未交付的数据可能丢失.
+     */
+    void moveTo(PelcoDReactor& target);
+
+    // 尚未写入内核的字节数
+    std::size_t pending() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mOutput.size() - mOutputHead;
+    }
+
+    /*!
+     * 线程安全的发送,不会阻塞调用线程.
+     * 发送缓冲区为空时直接写入内核,写不完的部分排队,可写后由事件循环继续发送.
+     * 通道未打开时返回 false 并丢弃数据.
+     */
+    bool write(PelcoDByteView data);
+    // 同上,发送缓冲区为空时直接接管 data 的内存而不拷贝
+    bool write(std::vector<std::uint8_t>&& data);
+    void send(const std::uint8_t* data, std::size_t size) {
+        write(PelcoDByteView(data, size));
+    }
+    /*!
+     * 无锁提交一个完整帧,供多个线程同时向同一端口发送.
+     * 帧进入通道的有界多生产者队列,队列由空变为非空时投递一次排空任务(经 eventfd 唤醒事件循环),
+     * 事件循环线程把积压的帧一次追加到发送缓冲区后写出.
+     * 队列满时调用者持锁把积压的帧连同本帧直接写出;同一线程先后 submit/write 的数据保持顺序.
+     * 通道未打开时返回 false 并丢弃帧.
+     */
+    bool submit(const PelcoDFrame& frame);
+
+    // 线程安全,可在事件循环线程内(包括回调中)调用
+    void close() {
+        closeWithError(0);
+    }
+
+    /*!
+     * 合并写:write 只追加到发送缓冲区并打开可写关注,由事件循环在下一轮一次性写出.
+     * 同一时刻发往同一连接的多帧合并为一次系统调用与一个 TCP 报文,代价是发送延迟增加一轮事件循环.
+     */
+    void setCoalesce(bool coalesce) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCoalesce = coalesce;
+    }
+
+protected:
+    // 接管已打开的非阻塞描述符并注册到事件循环;connecting 为 true 时等待首次可写再视为连接成功
+    void attach(int fd, bool connecting = false);
+    // 出错或对端关闭时关闭通道,error 为 errno,主动关闭时为 0
+    void closeWithError(int error);
+
+    // 等待事件循环结束当前这一轮,用于派生类析构前确保定时器回调等不再访问自身
+    void quiesce();
+
+    // 以下回调均在事件循环线程中执行,不持有通道锁,可在其中调用 write/close
+    virtual void onData(PelcoDByteView data) {
+        Receiver receiver;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            receiver = mReceiver;
+        }
+        if (receiver) {
+            receiver(data);
+        }
+    }
+    virtual void onConnected() {
+    }
+    virtual void onClosed(int error) {
+        (void)error;
+    }
+
+    // 可由 moveTo 改变,读取经 reactor()
+    std::atomic<PelcoDReactor*> mReactor;
+    Receiver mReceiver;
+
+private:
+    friend class PelcoDReactor;
+    friend class PelcoDEpollReactor;
+
+    // 可读:循环读取直至 EAGAIN,逐段交给 onData
+    void handleReadable();
+    // 可写:继续发送排队数据,发送完毕后取消可写关注
+    void handleWritable();
+    // 在持锁状态下尽量写入内核,返回 errno,0 表示成功或 EAGAIN
+    int flushLocked();
+    // 在持锁状态下取出非阻塞 connect 的结果,返回 errno
+    int connectResultLocked();
+    // 完成模型后端:连接完成、取走全部待发送数据
+    void handleConnected();
+    bool takeOutput(std::vector<std::uint8_t>& output);
+    // 在持锁状态下把无锁队列中的帧移入发送缓冲区;complete 为 true 时等待已占位的生产者写完
+    void drainLocked(bool complete);
+    // 事件循环线程中执行的排空任务
+    void drain();
+    // write/submit 的公共部分:数据已追加到发送缓冲区,idle 为追加前缓冲区是否为空
+    bool startWriteLocked(std::unique_lock<std::mutex>& lock, bool idle);
+
+    mutable std::mutex mMutex;
+    int mFd = -1;
+    bool mConnecting = false;
+    bool mWantWrite = false;
+    bool mCoalesce = false;
+    bool mSocket = false;
+    std::uint64_t mToken = 0;
+    std::vector<std::uint8_t> mOutput;
+    std::size_t mOutputHead = 0;
+    PelcoDFrameRing mRing;
+    // 打开时为通道令牌,关闭时为 0,供 submit 无锁判断
+    std::atomic<std::uint64_t> mLiveToken {0};
+    // 已投递排空任务且尚未开始排空
+    std::atomic<bool> mDrainPosted {false};
+    // 进行中的 submit 数
+    std::atomic<std::uint32_t> mSubmitting {0};
+    bool mMoving = false;
+};
+
+/*!
+ * 事件循环基类,负责任务投递、定时器与通道登记,具体的等待机制由派生类实现.
+ * run() 所在线程即为事件循环线程,通道回调、post 与 schedule 的任务都在该线程中执行.
+ */
+class PelcoDReactor {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+    using TimerId = std::uint64_t;
+
+    PelcoDReactor() = default;
+    PelcoDReactor(const PelcoDReactor&) = delete;
+    PelcoDReactor& operator=(const PelcoDReactor&) = delete;
+    virtual ~PelcoDReactor() = default;
+
+    // 线程安全,在事件循环线程中执行 task
+    void post(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.push_back(std::move(task));
+        }
+        wakeup();
+    }
+    // 线程安全,在 when 之后于事件循环线程中执行 task,返回值可用于 cancel
+    TimerId schedule(Clock::time_point when, Task task) {
+        TimerId id;
+        bool earliest;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::uint32_t index;
+            if (!mFreeTimers.empty()) {
+                index = mFreeTimers.back();
+                mFreeTimers.pop_back();
+            } else {
+                index = std::uint32_t(mTimerSlots.size());
+                mTimerSlots.emplace_back();
+            }
+            mTimerSlots[index].task = std::move(task);
+            id = TimerId(mTimerSlots[index].generation) << 32 | index;
+            earliest = mTimerHeap.empty() || when < mTimerHeap.front().when;
+            mTimerHeap.push_back({when, ++mNextTimer, id});
+            std::push_heap(mTimerHeap.begin(), mTimerHeap.end(), TimerEntry::later);
+        }
+        if (earliest) {
+            wakeup();
+        }
+        return id;
+    }
+    TimerId schedule(Clock::duration after, Task task) {
+        return schedule(Clock::now() + after, std::move(task));
+    }
+    // 线程安全,定时器已执行或不存在时返回 false
+    bool cancel(TimerId id) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!timerLive(id)) {
+            return false;
+        }
+        releaseTimer(id);
+        pruneTimers();
+        return true;
+    }
+
+    // 运行事件循环直至 stop()
+    void run() {
+        mLoopThread = std::this_thread::get_id();
+        mRunning = true;
+        while (!mStopped.exchange(false)) {
+            runOnce(-1);
+        }
+        mRunning = false;
+        mLoopThread = std::thread::id();
+        mIterationCond.notify_all();
+    }
+    // 等待至多 timeoutMs 毫秒(-1 为无限)处理一轮事件、到期定时器与投递的任务
+    void runOnce(int timeoutMs) {
+        // 负值表示无限等待;定时器以纳秒精度等待,总线调度依赖它贴近帧的线上时间
+        std::chrono::nanoseconds wait = timeoutMs < 0 ? std::chrono::nanoseconds(-1) : std::chrono::milliseconds(timeoutMs);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mTasks.empty()) {
+                wait = std::chrono::nanoseconds(0);
+            } else if (!mTimerHeap.empty()) {
+                auto remain = std::max(std::chrono::nanoseconds(mTimerHeap.front().when - Clock::now()), std::chrono::nanoseconds(0));
+                if (wait.count() < 0 || remain < wait) {
+                    wait = remain;
+                }
+            }
+        }
+        waitEvents(wait);
+        runTimers();
+        runTasks();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ++mIteration;
+        }
+        mIterationCond.notify_all();
+    }
+    // 线程安全
+    void stop() {
+        mStopped = true;
+        wakeup();
+    }
+    bool inLoopThread() const {
+        return mLoopThread == std::this_thread::get_id();
+    }
+    // 其他线程注销回调对象后等待当前这一轮分发结束,之后事件循环不会再访问该对象;在事件循环线程中调用时直接返回
+    void quiesce() {
+        if (!mRunning || inLoopThread()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto iteration = mIteration;
+        wakeupLocked(lock);
+        mIterationCond.wait(lock, [&] { return mIteration != iteration || !mRunning; });
+    }
+
+protected:
+    friend class PelcoDChannel;
+
+    // 派生类实现:登记/注销描述符、开关可写关注、等待并分发事件、唤醒等待
+    virtual void add(PelcoDChannel& channel, bool writable) = 0;
+    virtual void remove(PelcoDChannel& channel) = 0;
+    virtual void watchWritable(PelcoDChannel& channel, bool writable) = 0;
+    virtual void waitEvents(std::chrono::nanoseconds timeout) = 0;
+    virtual void wakeup() = 0;
+
+    // 通道持锁时调用,分配事件令牌
+    std::uint64_t registerChannel(PelcoDChannel& channel) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::uint64_t token = ++mNextToken;
+        mChannels.emplace(token, &channel);
+        return token;
+    }
+    void unregisterChannel(std::uint64_t token) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mChannels.erase(token);
+    }
+    // 通道已注销时返回 nullptr,同一轮中剩余的事件据此被忽略
+    PelcoDChannel* lookup(std::uint64_t token) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mChannels.find(token);
+        return it == mChannels.end() ? nullptr : it->second;
+    }
+    void dispatchReadable(PelcoDChannel& channel) {
+        channel.handleReadable();
+    }
+    void dispatchWritable(PelcoDChannel& channel) {
+        channel.handleWritable();
+    }
+    void dispatchError(PelcoDChannel& channel, int error) {
+        channel.closeWithError(error);
+    }
+
+    /*!
+     * 完成模型(io_uring)后端使用:inlineWrites 返回 false 时 write 不直接写入内核,
+     * 只调用 watchWritable(channel, true) 通知后端,由后端 takeOutput 取走数据后批量提交.
+     */
+    virtual bool inlineWrites() const {
+        return true;
+    }
+    void dispatchData(PelcoDChannel& channel, PelcoDByteView data) {
+        channel.onData(data);
+    }
+    void dispatchConnected(PelcoDChannel& channel) {
+        channel.handleConnected();
+    }
+    bool takeOutput(PelcoDChannel& channel, std::vector<std::uint8_t>& output) {
+        return channel.takeOutput(output);
+    }
+    // 以下三个只能在 add/remove/watchWritable 中调用,此时通道锁已由调用者持有
+    static int descriptor(const PelcoDChannel& channel) {
+        return channel.mFd;
+    }
+    static std::uint64_t token(const PelcoDChannel& channel) {
+        return channel.mToken;
+    }
+    static bool connecting(const PelcoDChannel& channel) {
+        return channel.mConnecting;
+    }
+
+private:
+    void wakeupLocked(std::unique_lock<std::mutex>& lock) {
+        lock.unlock();
+        wakeup();
+        lock.lock();
+    }
+    /*!
+     * 定时器存放在槽位表中,ID 为 代数 << 32 | 槽位,取消时槽位的代数加一,堆中的旧条目随之失效,到达堆顶时丢弃.
+     * 槽位、堆与任务队列都只增不减并反复使用,稳定运行后调度与投递不再分配内存.
+     */
+    struct TimerSlot {
+        Task task;
+        std::uint32_t generation = 1;
+    };
+    struct TimerEntry {
+        Clock::time_point when;
+        // 同一时刻的定时器按登记顺序执行
+        std::uint64_t sequence;
+        TimerId id;
+
+        static bool later(const TimerEntry& a, const TimerEntry& b) {
+            return a.when != b.when ? a.when > b.when : a.sequence > b.sequence;
+        }
+    };
+
+    // 以下三个须持有 mMutex
+    bool timerLive(TimerId id) const {
+        auto index = std::uint32_t(id);
+        return index < mTimerSlots.size() && mTimerSlots[index].generation == std::uint32_t(id >> 32);
+    }
+    Task releaseTimer(TimerId id) {
+        auto index = std::uint32_t(id);
+        TimerSlot& slot = mTimerSlots[index];
+        Task task = std::move(slot.task);
+        slot.task = nullptr;
+        if (++slot.generation == 0) {
+            slot.generation = 1;
+        }
+        mFreeTimers.push_back(index);
+        return task;
+    }
+    void pruneTimers() {
+        while (!mTimerHeap.empty() && !timerLive(mTimerHeap.front().id)) {
+            std::pop_heap(mTimerHeap.begin(), mTimerHeap.end(), TimerEntry::later);
+            mTimerHeap.pop_back();
+        }
+    }
+
+    void runTimers() {
+        auto now = Clock::now();
+        for (;;) {
+            Task task;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                pruneTimers();
+                if (mTimerHeap.empty() || mTimerHeap.front().when > now) {
+                    return;
+                }
+                TimerId id = mTimerHeap.front().id;
+                std::pop_heap(mTimerHeap.begin(), mTimerHeap.end(), TimerEntry::later);
+                mTimerHeap.pop_back();
+                task = releaseTimer(id);
+            }
+            task();
+        }
+    }
+    void runTasks() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRunQueue.swap(mTasks);
+        }
+        try {
+            for (auto& task : mRunQueue) {
+                task();
+            }
+        } catch (...) {
+            mRunQueue.clear();
+            throw;
+        }
+        mRunQueue.clear();
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mIterationCond;
+    std::vector<Task> mTasks;
+    // 只在事件循环线程中使用,与 mTasks 交换后逐个执行
+    std::vector<Task> mRunQueue;
+    std::vector<TimerSlot> mTimerSlots;
+    std::vector<std::uint32_t> mFreeTimers;
+    std::vector<TimerEntry> mTimerHeap;
+    std::unordered_map<std::uint64_t, PelcoDChannel*> mChannels;
+    TimerId mNextTimer = 0;
+    std::uint64_t mNextToken = 0;
+    std::uint64_t mIteration = 0;
+    std::atomic<bool> mStopped {false};
+    std::atomic<bool> mRunning {false};
+    std::atomic<std::thread::id> mLoopThread {};
+};
+
+// epoll 水平触发实现,可写关注只在有排队数据时打开
+class PelcoDEpollReactor : public PelcoDReactor {
+public:
+    PelcoDEpollReactor() {
+        mEpoll = ::epoll_create1(EPOLL_CLOEXEC);
+        mWakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (mEpoll < 0 || mWakeup < 0) {
+            throw std::runtime_error(std::string("pelco-d epoll: ") + std::strerror(errno));
+        }
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.u64 = 0;
+        ::epoll_ctl(mEpoll, EPOLL_CTL_ADD, mWakeup, &event);
+    }
+    ~PelcoDEpollReactor() override {
+        ::close(mWakeup);
+        ::close(mEpoll);
+    }
+
+protected:
+    void add(PelcoDChannel& channel, bool writable) override {
+        control(EPOLL_CTL_ADD, channel, writable);
+    }
+    void remove(PelcoDChannel& channel) override {
+        ::epoll_ctl(mEpoll, EPOLL_CTL_DEL, channel.mFd, nullptr);
+    }
+    void watchWritable(PelcoDChannel& channel, bool writable) override {
+        control(EPOLL_CTL_MOD, channel, writable);
+    }
+    void waitEvents(std::chrono::nanoseconds timeout) override {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35))
+        // epoll_pwait2(5.11+)支持纳秒超时,内核不支持时退回毫秒精度
+        int count = -1;
+        if (mPreciseWait) {
+            timespec ts {time_t(timeout.count() / 1000000000), long(timeout.count() % 1000000000)};
+            count = ::epoll_pwait2(mEpoll, mEvents.data(), int(mEvents.size()), timeout.count() < 0 ? nullptr : &ts, nullptr);
+            if (count < 0 && errno == ENOSYS) {
+                mPreciseWait = false;
+            }
+        }
+        if (!mPreciseWait) {
+            count = ::epoll_wait(mEpoll, mEvents.data(), int(mEvents.size()), timeoutMilliseconds(timeout));
+        }
+#else
+        int count = ::epoll_wait(mEpoll, mEvents.data(), int(mEvents.size()), timeoutMilliseconds(timeout));
+#endif
+        for (int i = 0; i < count; ++i) {
+            const epoll_event& event = mEvents[std::size_t(i)];
+            if (event.data.u64 == 0) {
+                std::uint64_t value;
+                while (::read(mWakeup, &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+            // 每次分发前重新查找,前面的回调可能已经关闭了该通道
+            if (event.events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                if (PelcoDChannel* channel = lookup(event.data.u64)) {
+                    dispatchReadable(*channel);
+                }
+            }
+            if (event.events & EPOLLOUT) {
+                if (PelcoDChannel* channel = lookup(event.data.u64)) {
+                    dispatchWritable(*channel);
+                }
+            }
+        }
+    }
+    void wakeup() override {
+        std::uint64_t one = 1;
+        (void)::write(mWakeup, &one, sizeof(one));
+    }
+
+private:
+    // 向上取整,避免定时器提前醒来后空转
+    static int timeoutMilliseconds(std::chrono::nanoseconds timeout) {
+        if (timeout.count() < 0) {
+            return -1;
+        }
+        auto ms = (timeout.count() + 999999) / 1000000;
+        return int(std::min<decltype(ms)>(ms, std::numeric_limits<int>::max()));
+    }
+    void control(int op, PelcoDChannel& channel, bool writable) {
+        epoll_event event {};
+        event.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0u);
+        event.data.u64 = channel.mToken;
+        ::epoll_ctl(mEpoll, op, channel.mFd, &event);
+    }
+
+    int mEpoll = -1;
+    int mWakeup = -1;
+    bool mPreciseWait = true;
+    std::array<epoll_event, 256> mEvents {};
+};
+
+inline bool PelcoDChannel::write(PelcoDByteView data) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mFd < 0) {
+        return false;
+    }
+    bool idle = mOutputHead == mOutput.size();
+    if (idle) {
+        mOutput.clear();
+        mOutputHead = 0;
+    }
+    // 先写出本线程之前 submit 的帧
+    drainLocked(true);
+    mOutput.insert(mOutput.end(), data.begin(), data.end());
+    return startWriteLocked(lock, idle);
+}
+
+inline bool PelcoDChannel::write(std::vector<std::uint8_t>&& data) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mFd < 0) {
+        return false;
+    }
+    bool idle = mOutputHead == mOutput.size();
+    if (idle) {
+        mOutput.clear();
+        mOutputHead = 0;
+    }
+    drainLocked(true);
+    if (mOutput.empty()) {
+        mOutput.swap(data);
+    } else {
+        mOutput.insert(mOutput.end(), data.begin(), data.end());
+    }
+    return startWriteLocked(lock, idle);
+}
+
+inline bool PelcoDChannel::submit(const PelcoDFrame& frame) {
+    // 计数供 moveTo 等待进行中的 submit 结束
+    mSubmitting.fetch_add(1, std::memory_order_seq_cst);
+    std::uint64_t token = mLiveToken.load(std::memory_order_seq_cst);
+    if (token == 0 || !mRing.push(frame)) {
+        mSubmitting.fetch_sub(1, std::memory_order_release);
+        // 已关闭时 write 返回 false;迁移中或队列满时持锁写入
+        return write(frame.view());
+    }
+    if (!mDrainPosted.exchange(true, std::memory_order_acq_rel)) {
+        PelcoDReactor* target = &reactor();
+        // 通道可能在任务执行前关闭或析构,经令牌查找
+        target->post([target, token] {
+            if (PelcoDChannel* channel = target->lookup(token)) {
+                channel->drain();
+            }
+        });
+    }
+    mSubmitting.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+inline void PelcoDChannel::drainLocked(bool complete) {
+    // 排在前面的槽已被其他生产者占位但尚未写完时,本线程之前入队的帧可能在其后,
+    // 直接写出新数据前必须等它写完,否则会越过本线程自己的帧
+    std::size_t until = complete ? mRing.claimed() : 0;
+    PelcoDFrame frame;
+    for (;;) {
+        if (mRing.pop(frame)) {
+            mOutput.insert(mOutput.end(), frame.bytes.begin(), frame.bytes.end());
+        } else if (complete && mRing.consumed() < until) {
+            std::this_thread::yield();
+        } else {
+            break;
+        }
+    }
+}
+
+inline void PelcoDChannel::drain() {
+    // 先清标志再取帧:之后入队的生产者会再投递一次,不会遗漏
+    mDrainPosted.exchange(false, std::memory_order_acq_rel);
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mFd < 0) {
+        return;
+    }
+    bool idle = mOutputHead == mOutput.size();
+    if (idle) {
+        mOutput.clear();
+        mOutputHead = 0;
+    }
+    drainLocked(false);
+    if (mOutputHead == mOutput.size()) {
+        return;
+    }
+    startWriteLocked(lock, idle);
+}
+
+inline bool PelcoDChannel::startWriteLocked(std::unique_lock<std::mutex>& lock, bool idle) {
+    // 迁移期间只排队,登记到新的事件循环时一并写出
+    if (!idle || mConnecting || mMoving) {
+        return true;
+    }
+    if (mCoalesce || !reactor().inlineWrites()) {
+        if (!mWantWrite) {
+            mWantWrite = true;
+            reactor().watchWritable(*this, true);
+        }
+        return true;
+    }
+    int error = flushLocked();
+    if (error != 0) {
+        lock.unlock();
+        closeWithError(error);
+        return false;
+    }
+    if (mOutputHead != mOutput.size() && !mWantWrite) {
+        mWantWrite = true;
+        reactor().watchWritable(*this, true);
+    }
+    return true;
+}
+
+inline void PelcoDChannel::moveTo(PelcoDReactor& target) {
+    PelcoDReactor& source = reactor();
+    if (&source == &target) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mFd < 0) {
+        mReactor.store(&target, std::memory_order_release);
+        return;
+    }
+    // 新的 submit 改走 write;等进行中的 submit 结束,它们投递的排空任务都指向原事件循环
+    mMoving = true;
+    mLiveToken.store(0, std::memory_order_seq_cst);
+    while (mSubmitting.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+    drainLocked(true);
+    source.unregisterChannel(mToken);
+    source.remove(*this);
+    lock.unlock();
+    // 原事件循环可能正在分发该通道的事件,等这一轮结束后它不会再访问该通道
+    source.quiesce();
+    lock.lock();
+    mReactor.store(&target, std::memory_order_release);
+    mMoving = false;
+    if (mFd < 0) {
+        return;
+    }
+    mToken = target.registerChannel(*this);
+    mWantWrite = mConnecting || mOutputHead != mOutput.size();
+    target.add(*this, mWantWrite);
+    mDrainPosted = false;
+    mLiveToken.store(mToken, std::memory_order_release);
+    lock.unlock();
+    target.wakeup();
+}
+
+inline void PelcoDChannel::quiesce() {
+    reactor().quiesce();
+}
+
+inline int PelcoDChannel::flushLocked() {
+    while (mOutputHead < mOutput.size()) {
+        // 套接字使用 MSG_NOSIGNAL,对端关闭时返回 EPIPE 而不是触发 SIGPIPE
+        ssize_t n = mSocket ? ::send(mFd, mOutput.data() + mOutputHead, mOutput.size() - mOutputHead, MSG_NOSIGNAL)
+                            : ::write(mFd, mOutput.data() + mOutputHead, mOutput.size() - mOutputHead);
+        if (n > 0) {
+            mOutputHead += std::size_t(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            return errno;
+        } else {
+            break;
+        }
+    }
+    return 0;
+}
+
+inline void PelcoDChannel::attach(int fd, bool connecting) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        struct stat status {};
+        mFd = fd;
+        mSocket = ::fstat(fd, &status) == 0 && S_ISSOCK(status.st_mode);
+        mConnecting = connecting;
+        mWantWrite = connecting || mOutputHead != mOutput.size();
+        mToken = reactor().registerChannel(*this);
+        reactor().add(*this, mWantWrite);
+        // 丢弃上次关闭前未排空的帧;旧令牌的排空任务已查找不到通道
+        PelcoDFrame stale;
+        while (mRing.pop(stale)) {
+        }
+        mDrainPosted = false;
+        mLiveToken.store(mToken, std::memory_order_release);
+    }
+    reactor().wakeup();
+}
+
+inline void PelcoDChannel::closeWithError(int error) {
+    int fd;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mFd < 0) {
+            return;
+        }
+        mLiveToken.store(0, std::memory_order_release);
+        // 迁移中已从原事件循环注销
+        if (!mMoving) {
+            reactor().unregisterChannel(mToken);
+            reactor().remove(*this);
+        }
+        fd = std::exchange(mFd, -1);
+        mConnecting = false;
+        mWantWrite = false;
+        mOutput.clear();
+        mOutputHead = 0;
+    }
+    ::close(fd);
+    reactor().quiesce();
+    onClosed(error);
+}
+
+inline void PelcoDChannel::handleReadable() {
+    std::uint8_t buffer[4096];
+    for (;;) {
+        ssize_t n;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mFd < 0) {
+                return;
+            }
+            n = ::read(mFd, buffer, sizeof(buffer));
+        }
+        if (n > 0) {
+            onData(PelcoDByteView(buffer, std::size_t(n)));
+            if (std::size_t(n) < sizeof(buffer)) {
+                return;
+            }
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        } else {
+            // 0 为对端关闭(TCP)或挂断(串口)
+            closeWithError(n == 0 ? ECONNRESET : errno);
+            return;
+        }
+    }
+}
+
+inline int PelcoDChannel::connectResultLocked() {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (::getsockopt(mFd, SOL_SOCKET, SO_ERROR, &error, &length) < 0) {
+        error = errno;
+    }
+    mConnecting = false;
+    return error;
+}
+
+inline void PelcoDChannel::handleConnected() {
+    int error;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mFd < 0 || !mConnecting) {
+            return;
+        }
+        error = connectResultLocked();
+    }
+    if (error != 0) {
+        closeWithError(error);
+        return;
+    }
+    onConnected();
+}
+
+inline bool PelcoDChannel::takeOutput(std::vector<std::uint8_t>& output) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWantWrite = false;
+    if (mFd < 0 || mConnecting || mOutputHead == mOutput.size()) {
+        return false;
+    }
+    output.clear();
+    output.swap(mOutput);
+    output.erase(output.begin(), output.begin() + std::ptrdiff_t(mOutputHead));
+    mOutputHead = 0;
+    return true;
+}
+
+inline void PelcoDChannel::handleWritable() {
+    bool connected = false;
+    int error = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mFd < 0) {
+            return;
+        }
+        if (mConnecting) {
+            error = connectResultLocked();
+            connected = error == 0;
+        }
+        if (error == 0) {
+            error = flushLocked();
+        }
+        if (error == 0 && mOutputHead == mOutput.size() && !mMoving) {
+            mOutput.clear();
+            mOutputHead = 0;
+            mWantWrite = false;
+            reactor().watchWritable(*this, false);
+        }
+    }
+    if (error != 0) {
+        closeWithError(error);
+        return;
+    }
+    if (connected) {
+        onConnected();
+    }
+}
+
+#if defined(PELCOD_HAS_IO_URING)
+
+/*!
+ * io_uring 后端,直接使用系统调用,不依赖 liburing.
+ * 写:write 只登记待发送的通道,事件循环在下一次 io_uring_enter 中把所有通道的数据作为一批 SQE 一并提交,
+ *    一次系统调用即可完成成百上千个设备的发送,并同时等待完成事件.
+ * 读:内核支持提供缓冲区环(5.19+)时对套接字投递 multishot recv,一次投递持续接收;
+ *    否则(以及串口)投递单次 read/recv,完成后重新投递.
+ * 所有在途请求使用后端持有的 dup 描述符与缓冲区,通道关闭后先取消在途请求再释放,不会访问已析构的通道.
+ * 内核不支持 io_uring 时构造函数抛出 std::runtime_error,makePelcoDReactor(PelcoDReactorBackend::IoUring) 会回退到 epoll.
+ */
+class PelcoDUringReactor : public PelcoDReactor {
+public:
+    // entries 为提交队列长度,应不小于一轮事件循环中需要发送的设备数,否则一批会拆成多次提交
+    explicit PelcoDUringReactor(unsigned entries = 4096) {
+        io_uring_params params {};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+        params.cq_entries = entries * 4;
+        mRing = int(::syscall(__NR_io_uring_setup, entries, &params));
+        if (mRing < 0 && errno == EINVAL) {
+            // 5.19 之前的内核不支持 SUBMIT_ALL/COOP_TASKRUN
+            params = io_uring_params {};
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = entries * 4;
+            mRing = int(::syscall(__NR_io_uring_setup, entries, &params));
+        }
+        if (mRing < 0) {
+            throw std::runtime_error(std::string("pelco-d io_uring: ") + std::strerror(errno));
+        }
+        if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP) || !mapRings(params)) {
+            unmapRings();
+            ::close(mRing);
+            throw std::runtime_error("pelco-d io_uring: kernel too old");
+        }
+        // 阻塞模式:io_uring 对 O_NONBLOCK 描述符的 read 会直接返回 EAGAIN
+        mWakeup = ::eventfd(0, EFD_CLOEXEC);
+        setupBufferRing();
+        armWakeup();
+    }
+    ~PelcoDUringReactor() override {
+        for (auto& [token, slot] : mSlots) {
+            ::close(slot.fd);
+        }
+        ::close(mRing);
+        unmapRings();
+        if (mBufferRing != nullptr) {
+            ::munmap(mBufferRing, mBufferRingSize);
+        }
+        ::close(mWakeup);
+    }
+
+    // 当前内核是否可以创建本后端
+    static bool available() {
+        try {
+            PelcoDUringReactor probe(8);
+            return true;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    // 套接字是否使用 multishot recv
+    bool multishot() const {
+        return mBufferRing != nullptr;
+    }
+    // io_uring_enter 调用次数,用于评估批量提交的效果
+    std::uint64_t enters() const {
+        return mEnters;
+    }
+
+protected:
+    bool inlineWrites() const override {
+        return false;
+    }
+    void add(PelcoDChannel& channel, bool writable) override {
+        struct stat status {};
+        Command command {Command::Add, token(channel), -1, false, connecting(channel), writable};
+        command.fd = ::fcntl(descriptor(channel), F_DUPFD_CLOEXEC, 0);
+        command.socket = ::fstat(command.fd, &status) == 0 && S_ISSOCK(status.st_mode);
+        pushCommand(command);
+    }
+    void remove(PelcoDChannel& channel) override {
+        pushCommand({Command::Remove, token(channel), -1, false, false, false});
+    }
+    void watchWritable(PelcoDChannel& channel, bool writable) override {
+        if (writable) {
+            pushCommand({Command::Flush, token(channel), -1, false, false, false});
+        }
+    }
+    void waitEvents(std::chrono::nanoseconds timeout) override {
+        runCommands();
+        enter(timeout);
+        reap();
+    }
+    void wakeup() override {
+        if (!inLoopThread() && !mWakeupPending.exchange(true)) {
+            std::uint64_t one = 1;
+            (void)::write(mWakeup, &one, sizeof(one));
+        }
+    }
+
+private:
+    enum Operation : std::uint64_t
+    {
+        OpWakeup,
+        OpRead,
+        OpReadPoll,
+        OpWrite,
+        OpWritePoll,
+        OpConnect,
+        OpCancel,
+    };
+    struct Command {
+        enum Type : std::uint8_t
+        {
+            Add,
+            Remove,
+            Flush,
+        } type;
+        std::uint64_t token;
+        int fd;
+        bool socket;
+        bool connecting;
+        bool writable;
+    };
+    struct Slot {
+        int fd = -1;
+        bool socket = false;
+        bool connecting = false;
+        bool closed = false;
+        bool reading = false;
+        bool writing = false;
+        int inflight = 0;
+        std::vector<std::uint8_t> input;
+        std::vector<std::uint8_t> output;
+        std::size_t outputHead = 0;
+    };
+
+    static constexpr unsigned kBufferCount = 256;
+    static constexpr unsigned kBufferSize = 2048;
+    static constexpr std::size_t kInputSize = 4096;
+
+    static std::uint64_t userData(std::uint64_t token, Operation op) {
+        return token << 8 | op;
+    }
+
+    bool mapRings(const io_uring_params& params) {
+        mSqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        mCqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            mSqSize = mCqSize = std::max(mSqSize, mCqSize);
+        }
+        void* sq = ::mmap(nullptr, mSqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing, IORING_OFF_SQ_RING);
+        if (sq == MAP_FAILED) {
+            return false;
+        }
+        mSq = static_cast<std::uint8_t*>(sq);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            mCq = mSq;
+        } else {
+            void* cq = ::mmap(nullptr, mCqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing, IORING_OFF_CQ_RING);
+            if (cq == MAP_FAILED) {
+                return false;
+            }
+            mCq = static_cast<std::uint8_t*>(cq);
+        }
+        mSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        mSqes = static_cast<io_uring_sqe*>(sqes);
+        mSqHead = reinterpret_cast<unsigned*>(mSq + params.sq_off.head);
+        mSqTail = reinterpret_cast<unsigned*>(mSq + params.sq_off.tail);
+        mSqMask = *reinterpret_cast<unsigned*>(mSq + params.sq_off.ring_mask);
+        mSqEntries = params.sq_entries;
+        mSqArray = reinterpret_cast<unsigned*>(mSq + params.sq_off.array);
+        mCqHead = reinterpret_cast<unsigned*>(mCq + params.cq_off.head);
+        mCqTail = reinterpret_cast<unsigned*>(mCq + params.cq_off.tail);
+        mCqMask = *reinterpret_cast<unsigned*>(mCq + params.cq_off.ring_mask);
+        mCqes = reinterpret_cast<io_uring_cqe*>(mCq + params.cq_off.cqes);
+        mLocalTail = *mSqTail;
+        return true;
+    }
+    void unmapRings() {
+        if (mSqes != nullptr) {
+            ::munmap(mSqes, mSqesSize);
+        }
+        if (mCq != nullptr && mCq != mSq) {
+            ::munmap(mCq, mCqSize);
+        }
+        if (mSq != nullptr) {
+            ::munmap(mSq, mSqSize);
+        }
+    }
+    // 注册提供缓冲区环,失败时退回单次接收
+    void setupBufferRing() {
+        mBufferRingSize = kBufferCount * sizeof(io_uring_buf);
+        void* ring = ::mmap(nullptr, mBufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED) {
+            return;
+        }
+        io_uring_buf_reg reg {};
+        reg.ring_addr = reinterpret_cast<std::uint64_t>(ring);
+        reg.ring_entries = kBufferCount;
+        reg.bgid = 0;
+        if (::syscall(__NR_io_uring_register, mRing, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+            ::munmap(ring, mBufferRingSize);
+            return;
+        }
+        mBufferRing = static_cast<io_uring_buf_ring*>(ring);
+        mBuffers.resize(std::size_t(kBufferCount) * kBufferSize);
+        for (unsigned i = 0; i < kBufferCount; ++i) {
+            provideBuffer(std::uint16_t(i));
+        }
+        publishBuffers();
+    }
+    void provideBuffer(std::uint16_t id) {
+        // 不使用 bufs[]:内核头文件的柔性数组宏在 C++ 中会多出一个空结构体,导致偏移错位
+        io_uring_buf& buffer = reinterpret_cast<io_uring_buf*>(mBufferRing)[(mBufferTail++) & (kBufferCount - 1)];
+        buffer.addr = reinterpret_cast<std::uint64_t>(mBuffers.data() + std::size_t(id) * kBufferSize);
+        buffer.len = kBufferSize;
+        buffer.bid = id;
+    }
+    void publishBuffers() {
+        __atomic_store_n(&mBufferRing->tail, mBufferTail, __ATOMIC_RELEASE);
+    }
+
+    io_uring_sqe* sqe() {
+        if (mLocalTail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE) == mSqEntries) {
+            // 提交队列已满,先提交一批
+            enterSubmit(0, 0, nullptr);
+        }
+        io_uring_sqe* entry = &mSqes[mLocalTail & mSqMask];
+        std::memset(entry, 0, sizeof(*entry));
+        mSqArray[mLocalTail & mSqMask] = mLocalTail & mSqMask;
+        ++mLocalTail;
+        ++mToSubmit;
+        return entry;
+    }
+    void enterSubmit(unsigned minComplete, unsigned flags, io_uring_getevents_arg* arg) {
+        __atomic_store_n(mSqTail, mLocalTail, __ATOMIC_RELEASE);
+        unsigned count = mToSubmit;
+        int result = int(::syscall(__NR_io_uring_enter, mRing, count, minComplete, flags | (arg ? IORING_ENTER_EXT_ARG : 0u), arg, arg ? sizeof(*arg) : 0));
+        ++mEnters;
+        if (result > 0) {
+            mToSubmit -= std::min(unsigned(result), mToSubmit);
+        }
+    }
+    void enter(std::chrono::nanoseconds wait) {
+        __kernel_timespec timeout {};
+        io_uring_getevents_arg arg {};
+        if (wait.count() >= 0) {
+            timeout.tv_sec = wait.count() / 1000000000;
+            timeout.tv_nsec = wait.count() % 1000000000;
+            arg.ts = reinterpret_cast<std::uint64_t>(&timeout);
+        }
+        bool ready = *mCqHead != __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+        if (ready || wait.count() == 0) {
+            if (mToSubmit != 0) {
+                enterSubmit(0, 0, nullptr);
+            }
+            return;
+        }
+        enterSubmit(1, IORING_ENTER_GETEVENTS, &arg);
+    }
+
+    void pushCommand(const Command& command) {
+        {
+            std::lock_guard<std::mutex> lock(mCommandMutex);
+            mCommands.push_back(command);
+        }
+        wakeup();
+    }
+    void runCommands() {
+        {
+            std::lock_guard<std::mutex> lock(mCommandMutex);
+            mRunning.swap(mCommands);
+        }
+        for (const Command& command : mRunning) {
+            switch (command.type) {
+            case Command::Add: {
+                Slot& slot = mSlots[command.token];
+                slot.fd = command.fd;
+                slot.socket = command.socket;
+                slot.connecting = command.connecting;
+                if (slot.connecting) {
+                    submitPoll(command.token, slot, OpConnect, POLLOUT);
+                } else {
+                    submitRead(command.token, slot);
+                    flush(command.token);
+                }
+                break;
+            }
+            case Command::Remove:
+                close(command.token);
+                break;
+            case Command::Flush:
+                flush(command.token);
+                break;
+            }
+        }
+        mRunning.clear();
+    }
+
+    void submitRead(std::uint64_t token, Slot& slot) {
+        io_uring_sqe* entry = sqe();
+        entry->fd = slot.fd;
+        entry->user_data = userData(token, OpRead);
+        if (slot.socket && mBufferRing != nullptr) {
+            entry->opcode = IORING_OP_RECV;
+            entry->ioprio = IORING_RECV_MULTISHOT;
+            entry->flags = IOSQE_BUFFER_SELECT;
+            entry->buf_group = 0;
+        } else {
+            slot.input.resize(kInputSize);
+            entry->opcode = slot.socket ? IORING_OP_RECV : IORING_OP_READ;
+            entry->addr = reinterpret_cast<std::uint64_t>(slot.input.data());
+            entry->len = kInputSize;
+            entry->off = std::uint64_t(-1);
+        }
+        slot.reading = true;
+        ++slot.inflight;
+    }
+    void submitWrite(std::uint64_t token, Slot& slot) {
+        io_uring_sqe* entry = sqe();
+        entry->opcode = slot.socket ? IORING_OP_SEND : IORING_OP_WRITE;
+        entry->fd = slot.fd;
+        entry->addr = reinterpret_cast<std::uint64_t>(slot.output.data() + slot.outputHead);
+        entry->len = unsigned(slot.output.size() - slot.outputHead);
+        entry->off = std::uint64_t(-1);
+        if (slot.socket) {
+            entry->msg_flags = MSG_NOSIGNAL;
+        }
+        entry->user_data = userData(token, OpWrite);
+        slot.writing = true;
+        ++slot.inflight;
+    }
+    // 非阻塞描述符不支持内部等待时(返回 EAGAIN)先等待就绪再重试
+    void submitPoll(std::uint64_t token, Slot& slot, Operation op, unsigned events) {
+        io_uring_sqe* entry = sqe();
+        entry->opcode = IORING_OP_POLL_ADD;
+        entry->fd = slot.fd;
+        entry->poll32_events = events;
+        entry->user_data = userData(token, op);
+        ++slot.inflight;
+    }
+    void submitCancel(std::uint64_t token, Operation op) {
+        io_uring_sqe* entry = sqe();
+        entry->opcode = IORING_OP_ASYNC_CANCEL;
+        entry->addr = userData(token, op);
+        entry->user_data = userData(0, OpCancel);
+    }
+    void armWakeup() {
+        io_uring_sqe* entry = sqe();
+        entry->opcode = IORING_OP_READ;
+        entry->fd = mWakeup;
+        entry->addr = reinterpret_cast<std::uint64_t>(&mWakeupValue);
+        entry->len = sizeof(mWakeupValue);
+        entry->user_data = userData(0, OpWakeup);
+    }
+
+    void flush(std::uint64_t token) {
+        auto it = mSlots.find(token);
+        if (it == mSlots.end() || it->second.closed || it->second.writing || it->second.connecting) {
+            return;
+        }
+        PelcoDChannel* channel = lookup(token);
+        if (channel != nullptr && takeOutput(*channel, it->second.output)) {
+            it->second.outputHead = 0;
+            submitWrite(token, it->second);
+        }
+    }
+    void close(std::uint64_t token) {
+        auto it = mSlots.find(token);
+        if (it == mSlots.end() || it->second.closed) {
+            return;
+        }
+        Slot& slot = it->second;
+        slot.closed = true;
+        for (Operation op : {OpRead, OpReadPoll, OpWrite, OpWritePoll, OpConnect}) {
+            submitCancel(token, op);
+        }
+        release(it);
+    }
+    void release(std::unordered_map<std::uint64_t, Slot>::iterator it) {
+        if (it->second.closed && it->second.inflight == 0) {
+            ::close(it->second.fd);
+            mSlots.erase(it);
+        }
+    }
+    // 在事件循环线程中关闭通道,通道会回调 remove 进而 close(token)
+    void fail(std::uint64_t token, int error) {
+        if (PelcoDChannel* channel = lookup(token)) {
+            dispatchError(*channel, error);
+        }
+    }
+
+    void reap() {
+        unsigned head = *mCqHead;
+        unsigned tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+        bool recycled = false;
+        // 回调中可能提交新的请求或关闭通道,先处理完当前可见的完成事件再统一推进 CQ 头
+        while (head != tail) {
+            for (; head != tail; ++head) {
+                const io_uring_cqe cqe = mCqes[head & mCqMask];
+                __atomic_store_n(mCqHead, head + 1, __ATOMIC_RELEASE);
+                recycled |= complete(cqe);
+            }
+            tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+        }
+        if (recycled) {
+            publishBuffers();
+        }
+    }
+    // 返回是否归还了提供缓冲区
+    bool complete(const io_uring_cqe& cqe) {
+        std::uint64_t token = cqe.user_data >> 8;
+        auto op = Operation(cqe.user_data & 0xff);
+        if (op == OpWakeup) {
+            mWakeupPending = false;
+            armWakeup();
+            return false;
+        }
+        if (op == OpCancel) {
+            return false;
+        }
+        auto it = mSlots.find(token);
+        if (it == mSlots.end()) {
+            return false;
+        }
+        Slot& slot = it->second;
+        bool more = op == OpRead && (cqe.flags & IORING_CQE_F_MORE);
+        if (!more) {
+            --slot.inflight;
+        }
+        bool recycled = false;
+        if (slot.closed) {
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                provideBuffer(std::uint16_t(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+                recycled = true;
+            }
+            release(it);
+            return recycled;
+        }
+        switch (op) {
+        case OpRead:
+            if (!more) {
+                slot.reading = false;
+            }
+            if (cqe.res > 0) {
+                const std::uint8_t* data = slot.input.data();
+                if (cqe.flags & IORING_CQE_F_BUFFER) {
+                    auto id = std::uint16_t(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                    data = mBuffers.data() + std::size_t(id) * kBufferSize;
+                    if (PelcoDChannel* channel = lookup(token)) {
+                        dispatchData(*channel, PelcoDByteView(data, std::size_t(cqe.res)));
+                    }
+                    provideBuffer(id);
+                    recycled = true;
+                } else if (PelcoDChannel* channel = lookup(token)) {
+                    dispatchData(*channel, PelcoDByteView(data, std::size_t(cqe.res)));
+                }
+                rearmRead(token);
+            } else if (cqe.res == -EAGAIN) {
+                submitPoll(token, slot, OpReadPoll, POLLIN);
+            } else if (cqe.res == -ENOBUFS || cqe.res == -EINTR) {
+                rearmRead(token);
+            } else if (cqe.res != -ECANCELED) {
+                fail(token, cqe.res == 0 ? ECONNRESET : -cqe.res);
+            }
+            break;
+        case OpReadPoll:
+            rearmRead(token);
+            break;
+        case OpWrite:
+            if (cqe.res >= 0) {
+                slot.outputHead += std::size_t(cqe.res);
+                if (slot.outputHead < slot.output.size()) {
+                    submitWrite(token, slot);
+                } else {
+                    slot.writing = false;
+                    flush(token);
+                }
+            } else if (cqe.res == -EAGAIN) {
+                submitPoll(token, slot, OpWritePoll, POLLOUT);
+            } else if (cqe.res != -ECANCELED) {
+                slot.writing = false;
+                fail(token, -cqe.res);
+            }
+            break;
+        case OpWritePoll:
+            submitWrite(token, slot);
+            break;
+        case OpConnect:
+            slot.connecting = false;
+            if (PelcoDChannel* channel = lookup(token)) {
+                dispatchConnected(*channel);
+            }
+            // 连接失败时上面的回调已关闭通道
+            it = mSlots.find(token);
+            if (it != mSlots.end() && !it->second.closed) {
+                submitRead(token, it->second);
+                flush(token);
+            }
+            break;
+        default:
+            break;
+        }
+        return recycled;
+    }
+    // 回调可能已关闭通道,需重新查找
+    void rearmRead(std::uint64_t token) {
+        auto it = mSlots.find(token);
+        if (it != mSlots.end() && !it->second.closed && !it->second.reading) {
+            submitRead(token, it->second);
+        }
+    }
+
+    int mRing = -1;
+    int mWakeup = -1;
+    std::uint64_t mWakeupValue = 0;
+    std::atomic<bool> mWakeupPending {false};
+    std::uint8_t* mSq = nullptr;
+    std::uint8_t* mCq = nullptr;
+    io_uring_sqe* mSqes = nullptr;
+    std::size_t mSqSize = 0;
+    std::size_t mCqSize = 0;
+    std::size_t mSqesSize = 0;
+    unsigned* mSqHead = nullptr;
+    unsigned* mSqTail = nullptr;
+    unsigned* mSqArray = nullptr;
+    unsigned mSqMask = 0;
+    unsigned mSqEntries = 0;
+    unsigned* mCqHead = nullptr;
+    unsigned* mCqTail = nullptr;
+    unsigned mCqMask = 0;
+    io_uring_cqe* mCqes = nullptr;
+    unsigned mLocalTail = 0;
+    unsigned mToSubmit = 0;
+    std::uint64_t mEnters = 0;
+    io_uring_buf_ring* mBufferRing = nullptr;
+    std::size_t mBufferRingSize = 0;
+    std::uint16_t mBufferTail = 0;
+    std::vector<std::uint8_t> mBuffers;
+    std::mutex mCommandMutex;
+    std::vector<Command> mCommands;
+    std::vector<Command> mRunning;
+    std::unordered_map<std::uint64_t, Slot> mSlots;
+};
+
+#endif // PELCOD_HAS_IO_URING
+
+enum class PelcoDReactorBackend : std::uint8_t
+{
+    Epoll,
+    IoUring,
+};
+
+/*!
+ * 创建事件循环.IoUring 在内核不支持或编译环境缺少 io_uring 头文件时回退到 epoll.
+ * io_uring 显著减少系统调用次数,但单次请求在内核中的开销可能高于直接 send,是否更快取决于内核与负载,应实测后选择.
+ */
+inline std::unique_ptr<PelcoDReactor> makePelcoDReactor(PelcoDReactorBackend backend = PelcoDReactorBackend::Epoll) {
+#if defined(PELCOD_HAS_IO_URING)
+    if (backend == PelcoDReactorBackend::IoUring) {
+        try {
+            return std::make_unique<PelcoDUringReactor>();
+        } catch (const std::runtime_error&) {
+        }
+    }
+#else
+    (void)backend;
+#endif
+    return std::make_unique<PelcoDEpollReactor>();
+}
+
+enum class PelcoDParity : std::uint8_t
+{
+    None,
+    Odd,
+    Even,
+};
+
+// Pelco-D 常用 2400/4800/9600 8N1
+struct PelcoDSerialOptions {
+    std::uint32_t baudRate = 2400;
+    PelcoDParity parity = PelcoDParity::None;
+    std::uint8_t dataBits = 8;
+    std::uint8_t stopBits = 1;
+};
+
+/*!
+ * 串口通道,以 O_NONBLOCK 打开并以 termios 配置为原始模式.
+ * 满足 BasicPelcoDProtocol 的 Transport 要求:BasicPelcoDProtocol<PelcoDSerialPort> ptz(0x01, reactor);
+ */
+class PelcoDSerialPort : public PelcoDChannel {
+public:
+    explicit PelcoDSerialPort(PelcoDReactor& reactor)
+        : PelcoDChannel(reactor) {
+    }
+    PelcoDSerialPort(PelcoDReactor& reactor, std::string path, const PelcoDSerialOptions& options = {})
+        : PelcoDChannel(reactor)
+        , mPath(std::move(path))
+        , mOptions(options) {
+    }
+    ~PelcoDSerialPort() override {
+        close();
+    }
+
+    void setPath(std::string path) {
+        mPath = std::move(path);
+    }
+    void setOptions(const PelcoDSerialOptions& options) {
+        mOptions = options;
+    }
+    const std::string& path() const {
+        return mPath;
+    }
+
+    // 打开并配置串口,失败时抛出 std::runtime_error
+    void open() {
+        int fd = ::open(mPath.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("pelco-d serial open " + mPath + ": " + std::strerror(errno));
+        }
+        if (::isatty(fd) && !configure(fd, mOptions)) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("pelco-d serial configure " + mPath + ": " + std::strerror(error));
+        }
+        attach(fd);
+    }
+    // 接管外部已打开的描述符,例如 openpty 得到的主端,描述符须已是非阻塞模式
+    void open(int fd) {
+        attach(fd);
+    }
+
+    static bool configure(int fd, const PelcoDSerialOptions& options) {
+        termios tty {};
+        if (::tcgetattr(fd, &tty) != 0) {
+            return false;
+        }
+        ::cfmakeraw(&tty);
+        speed_t speed = baudConstant(options.baudRate);
+        if (speed == B0) {
+            errno = EINVAL;
+            return false;
+        }
+        ::cfsetispeed(&tty, speed);
+        ::cfsetospeed(&tty, speed);
+        tty.c_cflag |= CLOCAL | CREAD;
+        tty.c_cflag &= ~tcflag_t(CSIZE | PARENB | PARODD | CSTOPB | CRTSCTS);
+        switch (options.dataBits) {
+        case 5: tty.c_cflag |= CS5; break;
+        case 6: tty.c_cflag |= CS6; break;
+        case 7: tty.c_cflag |= CS7; break;
+        default: tty.c_cflag |= CS8; break;
+        }
+        if (options.parity != PelcoDParity::None) {
+            tty.c_cflag |= PARENB;
+            if (options.parity == PelcoDParity::Odd) {
+                tty.c_cflag |= PARODD;
+            }
+        }
+        if (options.stopBits == 2) {
+            tty.c_cflag |= CSTOPB;
+        }
+        // VMIN=1:无数据时非阻塞读返回 EAGAIN;VMIN=0 时返回 0,无法与挂断区分
+        tty.c_cc[VMIN] = 1;
+        tty.c_cc[VTIME] = 0;
+        if (::tcsetattr(fd, TCSANOW, &tty) != 0) {
+            return false;
+        }
+        ::tcflush(fd, TCIOFLUSH);
+        return true;
+    }
+    static speed_t baudConstant(std::uint32_t baudRate) {
+        switch (baudRate) {
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        default: return B0;
+        }
+    }
+
+private:
+    std::string mPath;
+    PelcoDSerialOptions mOptions;
+};
+
+/*!
+ * 以事件循环定时器驱动 PelcoDQueryTracker::poll(),设备不响应时查询也能按时重发与超时.
+ * arm() 可在任意线程调用;所属对象析构时先调用 cancel(),之后定时器不会再访问 tracker.
+ */
+class PelcoDQueryTimer {
+public:
+    using Clock = PelcoDReactor::Clock;
+
+    explicit PelcoDQueryTimer(PelcoDQueryTracker& tracker)
+        : mTracker(tracker) {
+    }
+    PelcoDQueryTimer(const PelcoDQueryTimer&) = delete;
+    PelcoDQueryTimer& operator=(const PelcoDQueryTimer&) = delete;
+    ~PelcoDQueryTimer() {
+        cancel();
+    }
+
+    // 在 deadline 调用 poll();已有不晚于 deadline 的定时器时不重复登记
+    void arm(PelcoDReactor& reactor, Clock::time_point deadline) {
+        if (deadline == Clock::time_point::max()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mClosed) {
+            return;
+        }
+        if (mTimer != 0) {
+            if (mReactor == &reactor && mDeadline <= deadline) {
+                return;
+            }
+            mReactor->cancel(mTimer);
+        }
+        // 序号区分已被替换但仍在执行的旧定时器
+        auto sequence = ++mSequence;
+        mReactor = &reactor;
+        mDeadline = deadline;
+        mTimer = reactor.schedule(deadline, [this, &reactor, sequence] { fire(reactor, sequence); });
+    }
+    void cancel() {
+        PelcoDReactor* reactor;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mClosed = true;
+            reactor = mReactor;
+            if (mTimer != 0) {
+                reactor->cancel(mTimer);
+                mTimer = 0;
+            }
+        }
+        if (reactor != nullptr) {
+            reactor->quiesce();
+        }
+    }
+
+private:
+    void fire(PelcoDReactor& reactor, std::uint64_t sequence) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mClosed || sequence != mSequence) {
+                return;
+            }
+            mTimer = 0;
+        }
+        try {
+            arm(reactor, mTracker.poll());
+        } catch (const std::exception& e) {
+            // 重发失败时下一个截止时间仍会到来
+            std::cout << e.what() << std::endl;
+            arm(reactor, mTracker.nextDeadline());
+        }
+    }
+
+    PelcoDQueryTracker& mTracker;
+    std::mutex mMutex;
+    PelcoDReactor* mReactor = nullptr;
+    PelcoDReactor::TimerId mTimer = 0;
+    Clock::time_point mDeadline {};
+    std::uint64_t mSequence = 0;
+    bool mClosed = false;
+};
+
+/*!
+ * 串口版 SimplePelcoDProtocolImpl.sendData 不阻塞,响应在事件循环线程中经 receiveData 解析.
+ * 多个设备共用一条 RS-485 总线时应共用同一个 PelcoDSerialPort,参见 PelcoDSerialProtocol(PelcoDSerialPort&).
+ */
+class PelcoDSerialProtocol : public SimplePelcoDProtocolImpl {
+public:
+    PelcoDSerialProtocol(PelcoDReactor& reactor, std::string path, const PelcoDSerialOptions& options = {})
+        : mOwnedPort(std::make_unique<PelcoDSerialPort>(reactor, std::move(path), options))
+        , mPort(*mOwnedPort) {
+        mPort.setReceiver([this](PelcoDByteView data) { receiveData(data); });
+    }
+    // 共用外部端口,由调用者负责端口的打开与接收分发
+    explicit PelcoDSerialProtocol(PelcoDSerialPort& port)
+        : mPort(port) {
+    }
+    ~PelcoDSerialProtocol() override {
+        cancelPulse();
+        mQueryTimer.cancel();
+        if (mOwnedPort) {
+            mOwnedPort->close();
+        }
+    }
+
+    PelcoDSerialPort& port() {
+        return mPort;
+    }
+
+    virtual void connect() override {
+        if (!mPort.isOpen()) {
+            mPort.open();
+        }
+    }
+    virtual void disconnect() override {
+        mPort.close();
+    }
+    virtual bool isConnected() override {
+        return mPort.isOpen();
+    }
+
+    using SimplePelcoDProtocolImpl::receiveData;
+
+protected:
+    using SimplePelcoDProtocolImpl::sendData;
+    virtual void sendData(PelcoDByteView data) override {
+        // 完整帧走无锁队列,多个线程同时控制同一端口时不争用通道锁
+        if (data.size() == PelcoDFrame::kSize) {
+            PelcoDFrame frame;
+            std::copy(data.begin(), data.end(), frame.bytes.begin());
+            mPort.submit(frame);
+            return;
+        }
+        mPort.write(data);
+    }
+    virtual void sendData(std::vector<std::uint8_t>&& data) override {
+        if (data.size() == PelcoDFrame::kSize) {
+            sendData(PelcoDByteView(data));
+            return;
+        }
+        mPort.write(std::move(data));
+    }
+
+    virtual void watchQueries() override {
+        mQueryTimer.arm(mPort.reactor(), mQueries.nextDeadline());
+    }
+    virtual bool inEventLoop() override {
+        return mPort.reactor().inLoopThread();
+    }
+
+private:
+    std::unique_ptr<PelcoDSerialPort> mOwnedPort;
+    PelcoDSerialPort& mPort;
+    PelcoDQueryTimer mQueryTimer {mQueries};
+};
+
+struct PelcoDTcpOptions {
+    // 断线重连间隔,从 minBackoff 开始逐次翻倍直至 maxBackoff,连接成功后复位
+    std::chrono::milliseconds minBackoff {100};
+    std::chrono::milliseconds maxBackoff {5000};
+    bool noDelay = true;
+    bool coalesce = true;
+    bool reconnect = true;
+};
+
+/*!
+ * 串口服务器 TCP 连接.connect 为非阻塞,失败或断线后在事件循环中按退避间隔自动重连,不阻塞调用者.
+ * 断线期间 write 返回 false 并丢弃数据,避免恢复后补发过期的运动指令;连接建立过程中写入的数据排队,连上后一并发送.
+ * host 须为 IPv4/IPv6 数字地址,不做可能阻塞的域名解析.
+ */
+class PelcoDTcpChannel : public PelcoDChannel {
+public:
+    explicit PelcoDTcpChannel(PelcoDReactor& reactor, const PelcoDTcpOptions& options = {})
+        : PelcoDChannel(reactor)
+        , mOptions(options)
+        , mBackoff(options.minBackoff) {
+        setCoalesce(options.coalesce);
+    }
+    PelcoDTcpChannel(PelcoDReactor& reactor, std::string host, std::uint16_t port, const PelcoDTcpOptions& options = {})
+        : PelcoDTcpChannel(reactor, options) {
+        mHost = std::move(host);
+        mPort = port;
+    }
+    ~PelcoDTcpChannel() override {
+        shutdown();
+    }
+
+    void setEndpoint(std::string host, std::uint16_t port) {
+        std::lock_guard<std::mutex> lock(mEndpointMutex);
+        mHost = std::move(host);
+        mPort = port;
+    }
+    // 已建立连接(connect 已完成)
+    bool isConnected() const {
+        return isOpen() && !isConnecting();
+    }
+    // 累计建立连接的次数
+    std::uint64_t connects() const {
+        return mConnects;
+    }
+
+    // 发起连接并保持,地址非法时抛出 std::invalid_argument
+    void open() {
+        sockaddr_storage address {};
+        socklen_t length = 0;
+        {
+            std::lock_guard<std::mutex> lock(mEndpointMutex);
+            if (!resolve(mHost, mPort, address, length)) {
+                throw std::invalid_argument("pelco-d tcp address " + mHost);
+            }
+        }
+        mActive = true;
+        {
+            std::lock_guard<std::mutex> lock(mRetryMutex);
+            mBackoff = mOptions.minBackoff;
+        }
+        if (!isOpen()) {
+            startConnect();
+        }
+    }
+    // 断开并停止重连
+    void shutdown() {
+        mActive = false;
+        cancelRetry();
+        // 等待可能正在执行的重连回调结束,再关闭它刚建立的连接
+        quiesce();
+        close();
+    }
+
+    static bool resolve(const std::string& host, std::uint16_t port, sockaddr_storage& address, socklen_t& length) {
+        auto* v4 = reinterpret_cast<sockaddr_in*>(&address);
+        if (::inet_pton(AF_INET, host.c_str(), &v4->sin_addr) == 1) {
+            v4->sin_family = AF_INET;
+            v4->sin_port = htons(port);
+            length = sizeof(sockaddr_in);
+            return true;
+        }
+        auto* v6 = reinterpret_cast<sockaddr_in6*>(&address);
+        if (::inet_pton(AF_INET6, host.c_str(), &v6->sin6_addr) == 1) {
+            v6->sin6_family = AF_INET6;
+            v6->sin6_port = htons(port);
+            length = sizeof(sockaddr_in6);
+            return true;
+        }
+        return false;
+    }
+
+protected:
+    void onConnected() override {
+        ++mConnects;
+        std::lock_guard<std::mutex> lock(mRetryMutex);
+        mBackoff = mOptions.minBackoff;
+    }
+    void onClosed(int error) override {
+        if (error != 0) {
+            scheduleRetry();
+        }
+    }
+
+private:
+    void startConnect() {
+        if (!mActive) {
+            return;
+        }
+        sockaddr_storage address {};
+        socklen_t length = 0;
+        {
+            std::lock_guard<std::mutex> lock(mEndpointMutex);
+            resolve(mHost, mPort, address, length);
+        }
+        int fd = ::socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            scheduleRetry();
+            return;
+        }
+        int on = 1;
+        if (mOptions.noDelay) {
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+        int result = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), length);
+        if (result == 0) {
+            attach(fd);
+            onConnected();
+        } else if (errno == EINPROGRESS) {
+            attach(fd, true);
+        } else {
+            ::close(fd);
+            scheduleRetry();
+        }
+    }
+    void scheduleRetry() {
+        if (!mActive || !mOptions.reconnect) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mRetryMutex);
+        auto backoff = mBackoff;
+        mBackoff = std::min(mBackoff * 2, mOptions.maxBackoff);
+        mRetry = reactor().schedule(backoff, [this] {
+            {
+                std::lock_guard<std::mutex> lock(mRetryMutex);
+                mRetry = 0;
+            }
+            startConnect();
+        });
+    }
+    void cancelRetry() {
+        std::lock_guard<std::mutex> lock(mRetryMutex);
+        if (mRetry != 0) {
+            reactor().cancel(mRetry);
+            mRetry = 0;
+        }
+    }
+
+    PelcoDTcpOptions mOptions;
+    std::mutex mEndpointMutex;
+    std::string mHost;
+    std::uint16_t mPort = 0;
+    std::atomic<bool> mActive {false};
+    std::chrono::milliseconds mBackoff;
+    std::mutex mRetryMutex;
+    PelcoDReactor::TimerId mRetry = 0;
+    std::atomic<std::uint64_t> mConnects {0};
+};
+
+/*!
+ * 串口服务器版 SimplePelcoDProtocolImpl,connect 使用 config()->ip() 与 config()->port().
+ * 同一串口服务器下挂多个设备时应共用同一个 PelcoDTcpChannel,参见 PelcoDTcpProtocol(PelcoDTcpChannel&).
+ */
+class PelcoDTcpProtocol : public SimplePelcoDProtocolImpl {
+public:
+    explicit PelcoDTcpProtocol(PelcoDReactor& reactor, const PelcoDTcpOptions& options = {})
+        : mOwnedChannel(std::make_unique<PelcoDTcpChannel>(reactor, options))
+        , mChannel(*mOwnedChannel) {
+        mChannel.setReceiver([this](PelcoDByteView data) { receiveData(data); });
+    }
+    // 共用外部连接,由调用者负责连接的建立与接收分发
+    explicit PelcoDTcpProtocol(PelcoDTcpChannel& channel)
+        : mChannel(channel) {
+    }
+    ~PelcoDTcpProtocol() override {
+        cancelPulse();
+        mQueryTimer.cancel();
+        if (mOwnedChannel) {
+            mOwnedChannel->shutdown();
+        }
+    }
+
+    PelcoDTcpChannel& channel() {
+        return mChannel;
+    }
+
+    // 未设置配置时抛出 std::logic_error;连接在后台建立,可通过 isConnected 查询
+    virtual void connect() override {
+        PelcoDProtocolConfig* cfg = config();
+        if (cfg == nullptr) {
+            throw std::logic_error("pelco-d tcp connect without config");
+        }
+        mChannel.setEndpoint(cfg->ip(), std::uint16_t(cfg->port()));
+        mChannel.open();
+    }
+    virtual void disconnect() override {
+        mChannel.shutdown();
+    }
+    virtual bool isConnected() override {
+        return mChannel.isConnected();
+    }
+
+    using SimplePelcoDProtocolImpl::receiveData;
+
+protected:
+    using SimplePelcoDProtocolImpl::sendData;
+    virtual void sendData(PelcoDByteView data) override {
+        if (data.size() == PelcoDFrame::kSize) {
+            PelcoDFrame frame;
+            std::copy(data.begin(), data.end(), frame.bytes.begin());
+            mChannel.submit(frame);
+            return;
+        }
+        mChannel.write(data);
+    }
+    virtual void sendData(std::vector<std::uint8_t>&& data) override {
+        if (data.size() == PelcoDFrame::kSize) {
+            sendData(PelcoDByteView(data));
+            return;
+        }
+        mChannel.write(std::move(data));
+    }
+
+    virtual void watchQueries() override {
+        mQueryTimer.arm(mChannel.reactor(), mQueries.nextDeadline());
+    }
+    virtual bool inEventLoop() override {
+        return mChannel.reactor().inLoopThread();
+    }
+
+private:
+    std::unique_ptr<PelcoDTcpChannel> mOwnedChannel;
+    PelcoDTcpChannel& mChannel;
+    PelcoDQueryTimer mQueryTimer {mQueries};
+};
+
+/*!
+ * 一条多点总线.持有通道的接收回调,按 PelcoDBusScheduler 的节奏在事件循环线程中写出各设备的帧,
+ * 并把解析出的帧按地址分发给挂在总线上的设备.通道的打开与关闭由调用者负责.
+ *
+ * PelcoDSerialPort port(reactor, "/dev/ttyUSB0", {2400});
+ * PelcoDBus bus(port, {2400});
+ * PelcoDBusProtocol dome1(bus, 0x01), dome2(bus, 0x02);
+ * port.open();
+ */
+class PelcoDBus {
+public:
+    using FrameHandler = std::function<void(const PelcoDFrameView&)>;
+    // sent 为 true 表示总线写出的帧,否则为收到的帧
+    using FrameObserver = std::function<void(const PelcoDFrameView& frame, bool sent)>;
+
+    PelcoDBus(PelcoDChannel& channel, const PelcoDBusTiming& timing = {})
+        : mChannel(channel)
+        , mScheduler(timing) {
+        mChannel.setReceiver([this](PelcoDByteView data) { receive(data); });
+    }
+    PelcoDBus(const PelcoDBus&) = delete;
+    PelcoDBus& operator=(const PelcoDBus&) = delete;
+    ~PelcoDBus() {
+        mChannel.setReceiver(nullptr);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mClosed = true;
+            if (mTimer != 0) {
+                mChannel.reactor().cancel(mTimer);
+            }
+        }
+        mChannel.reactor().quiesce();
+    }
+
+    PelcoDChannel& channel() {
+        return mChannel;
+    }
+    PelcoDBusScheduler& scheduler() {
+        return mScheduler;
+    }
+
+    // 连同通道迁移到另一个事件循环,排队中的帧保持不变;可在任意线程调用
+    void moveTo(PelcoDReactor& target) {
+        PelcoDReactor& source = mChannel.reactor();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mMoving = true;
+            if (mTimer != 0) {
+                source.cancel(mTimer);
+                mTimer = 0;
+            }
+        }
+        // 正在执行的 run() 结束后不会再在原事件循环上登记定时器
+        source.quiesce();
+        mChannel.moveTo(target);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mMoving = false;
+        }
+        arm(PelcoDBusScheduler::Clock::now());
+    }
+
+    // 线程安全,排队一帧并在线路空闲时发出
+    void submit(const PelcoDFrame& frame) {
+        mScheduler.submit(frame);
+        arm(PelcoDBusScheduler::Clock::now());
+    }
+    // 多帧数据按 7 字节拆分,长度不是 7 的整数倍时抛出 std::invalid_argument
+    void submit(PelcoDByteView data) {
+        if (data.size() % PelcoDFrame::kSize != 0) {
+            throw std::invalid_argument("pelco-d bus frames must be 7 bytes");
+        }
+        for (std::size_t i = 0; i < data.size(); i += PelcoDFrame::kSize) {
+            mScheduler.submit(PelcoDByteView(data.data() + i, PelcoDFrame::kSize));
+        }
+        arm(PelcoDBusScheduler::Clock::now());
+    }
+
+    // 登记 address 的帧处理函数,同一地址只保留一个
+    void attach(std::uint8_t address, FrameHandler handler) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mHandlers[address] = std::move(handler);
+    }
+    // 注销后等待事件循环结束当前分发,返回后不会再调用该地址的处理函数
+    void detach(std::uint8_t address) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mHandlers.erase(address);
+        }
+        mChannel.reactor().quiesce();
+    }
+    // 在事件循环线程中观察总线上所有写出与收到的帧,不受地址登记影响;传入空函数取消
+    void observe(FrameObserver observer) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mObserver = std::move(observer);
+        }
+        mChannel.reactor().quiesce();
+    }
+
+    // 通道收到的原始字节,在事件循环线程中调用
+    void receive(PelcoDByteView data) {
+        mParser.feed(data, [this](const PelcoDFrameView& frame) {
+            PelcoDQuery query;
+            if (pelcoDQueryFromResponse(frame.command(), query)) {
+                mScheduler.responseReceived(frame.address());
+                arm(PelcoDBusScheduler::Clock::now());
+            }
+            FrameHandler handler;
+            FrameObserver observer;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                observer = mObserver;
+                auto it = mHandlers.find(frame.address());
+                if (it != mHandlers.end()) {
+                    handler = it->second;
+                }
+            }
+            if (observer) {
+                observer(frame, false);
+            }
+            if (handler) {
+                handler(frame);
+            }
+        });
+    }
+
+private:
+    // 在 when 唤醒事件循环发送;已有更早的唤醒时不重复登记
+    void arm(PelcoDBusScheduler::Clock::time_point when) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mClosed || mMoving || (mTimer != 0 && mTimerAt <= when)) {
+            return;
+        }
+        if (mTimer != 0) {
+            mChannel.reactor().cancel(mTimer);
+        }
+        mTimerAt = when;
+        mTimer = mChannel.reactor().schedule(when, [this] { run(); });
+    }
+    void run() {
+        FrameObserver observer;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTimer = 0;
+            observer = mObserver;
+        }
+        auto next = mScheduler.poll([this, &observer](const PelcoDFrame& frame) {
+            mChannel.write(frame.view());
+            if (observer) {
+                observer(PelcoDFrameView(frame.data()), true);
+            }
+        });
+        if (next != PelcoDBusScheduler::Clock::time_point::max()) {
+            arm(next);
+        }
+    }
+
+    PelcoDChannel& mChannel;
+    PelcoDBusScheduler mScheduler;
+    PelcoDFrameParser mParser;
+    std::mutex mMutex;
+    std::unordered_map<std::uint8_t, FrameHandler> mHandlers;
+    FrameObserver mObserver;
+    PelcoDReactor::TimerId mTimer = 0;
+    PelcoDBusScheduler::Clock::time_point mTimerAt {};
+    bool mClosed = false;
+    bool mMoving = false;
+};
+
+/*!
+ * 总线上的一个设备.指令经总线调度器排队发送,不再与同一总线上的其他设备冲突.
+ * 排队会增加查询的等待时间,设备较多时应相应调大 queryTracker().setTimeout().
+ */
+class PelcoDBusProtocol : public SimplePelcoDProtocolImpl {
+public:
+    PelcoDBusProtocol(PelcoDBus& bus, std::uint8_t address)
+        : mBus(bus)
+        , mAttachedAddress(address) {
+        mDeviceAddress = address;
+        attach();
+    }
+    ~PelcoDBusProtocol() override {
+        cancelPulse();
+        mQueryTimer.cancel();
+        mBus.detach(mAttachedAddress);
+    }
+
+    // 修改地址时把总线上的响应分发一并改到新地址
+    virtual void setAnyValue(std::uint8_t type, const std::any& value) override {
+        SimplePelcoDProtocolImpl::setAnyValue(type, value);
+        if (type == 0 && mDeviceAddress != mAttachedAddress) {
+            mBus.detach(mAttachedAddress);
+            mAttachedAddress = mDeviceAddress;
+            attach();
+        }
+    }
+
+    PelcoDBus& bus() {
+        return mBus;
+    }
+
+    // 通道由总线所有者打开与关闭
+    virtual void connect() override {
+    }
+    virtual void disconnect() override {
+    }
+    virtual bool isConnected() override {
+        return mBus.channel().isOpen();
+    }
+
+protected:
+    using SimplePelcoDProtocolImpl::sendData;
+    virtual void sendData(PelcoDByteView data) override {
+        mBus.submit(data);
+    }
+    virtual void watchQueries() override {
+        mQueryTimer.arm(mBus.channel().reactor(), mQueries.nextDeadline());
+    }
+    virtual bool inEventLoop() override {
+        return mBus.channel().reactor().inLoopThread();
+    }
+
+private:
+    void attach() {
+        mBus.attach(mAttachedAddress, [this](const PelcoDFrameView& frame) {
+            receiveFrame(frame);
+            mQueries.poll();
+        });
+    }
+
+    PelcoDBus& mBus;
+    // 在总线上登记响应分发的地址;mDeviceAddress 可由子类直接改写,析构时以此为准注销
+    std::uint8_t mAttachedAddress;
+    PelcoDQueryTimer mQueryTimer {mQueries};
+};
+
+/*!
+ * 大规模部署:上万台设备分布在数百条总线上,总线分片到若干工作线程,每个线程运行自己的事件循环.
+ * 一条总线的串口、调度器与定时器只属于一个线程,线程之间不共享可变状态.
+ * 总线与摄像机 → 总线的映射在 start() 之前建立,之后只读,camera()/post() 按摄像机 ID 路由无需加锁;
+ * 总线 → 线程的归属以原子指针保存,rebalance() 集中统计各线程的负载,把最繁忙线程上的总线迁到最空闲的线程;
+ * start() 可让第一个线程周期性地调用它.空闲线程不会主动窃取其他线程的总线.
+ *
+ * 每条总线上的摄像机登记在该总线的 PelcoDDeviceTable 中,总线上写出与收到的帧直接更新表中的
+ * 最近指令与 pan/tilt/zoom 缓存.query()/position()/staleCameras() 只经由设备表,
+ * 完整的 PelcoDBusProtocol 在首次调用 camera()/post() 时才创建,只做巡检的摄像机不占用协议对象.
+ * 摄像机地址以 addCamera() 登记的为准,不要通过 camera().setAnyValue(0, ...) 修改.
+ *
+ * PelcoDFleet fleet(4);
+ * auto bus = fleet.addBus("/dev/ttyS0", {9600});
+ * fleet.addCamera(1001, bus, 0x01);
+ * fleet.start(std::chrono::seconds(5));
+ * fleet.camera(1001).panLeft(0x20);
+ */
+class PelcoDFleet {
+public:
+    using CameraId = std::uint32_t;
+    using BusId = std::size_t;
+
+    explicit PelcoDFleet(std::size_t workers = std::max(1u, std::thread::hardware_concurrency()),
+                         PelcoDReactorBackend backend = PelcoDReactorBackend::Epoll) {
+        for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i) {
+            auto shard = std::make_unique<Shard>();
+            shard->index = i;
+            shard->reactor = makePelcoDReactor(backend);
+            mShards.push_back(std::move(shard));
+        }
+    }
+    PelcoDFleet(const PelcoDFleet&) = delete;
+    PelcoDFleet& operator=(const PelcoDFleet&) = delete;
+    ~PelcoDFleet() {
+        {
+            std::lock_guard<std::mutex> lock(mRebalanceMutex);
+            mStopping = true;
+            if (mRebalanceTimer != 0) {
+                mShards.front()->reactor->cancel(mRebalanceTimer);
+            }
+        }
+        mShards.front()->reactor->quiesce();
+        mCameras.clear();
+        for (auto& bus : mBuses) {
+            bus->bus.reset();
+            bus->port->close();
+        }
+        for (auto& shard : mShards) {
+            shard->reactor->stop();
+            if (shard->thread.joinable()) {
+                shard->thread.join();
+            }
+        }
+        mBuses.clear();
+    }
+
+    // 在 start() 之前打开串口作为一条总线,分配到总线最少的线程;打开失败时抛出 std::runtime_error,已启动时抛出 std::logic_error
+    BusId addBus(std::string path, const PelcoDSerialOptions& options = {}, const PelcoDBusTiming& timing = {}) {
+        checkNotStarted();
+        Shard& shard = lightest();
+        auto port = std::make_unique<PelcoDSerialPort>(*shard.reactor, std::move(path), options);
+        port->open();
+        return addBus(shard, std::move(port), timing);
+    }
+    // 在 start() 之前接管已打开的非阻塞描述符(串口或串口服务器连接);已启动时抛出 std::logic_error,描述符仍归调用者
+    BusId addBus(int fd, const PelcoDBusTiming& timing = {}) {
+        checkNotStarted();
+        Shard& shard = lightest();
+        auto port = std::make_unique<PelcoDSerialPort>(*shard.reactor);
+        port->open(fd);
+        return addBus(shard, std::move(port), timing);
+    }
+    // 在 start() 之前登记摄像机,ID 重复、同一总线上地址重复或已启动时抛出 std::logic_error
+    void addCamera(CameraId camera, BusId bus, std::uint8_t address) {
+        if (mStarted) {
+            throw std::logic_error("pelco-d fleet cameras must be added before start()");
+        }
+        auto& entry = *mBuses.at(bus);
+        if (mCameras.count(camera) != 0) {
+            throw std::logic_error("pelco-d fleet camera id already used");
+        }
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        if (entry.devices.contains(entry.handles[address])) {
+            throw std::logic_error("pelco-d fleet camera address already used on this bus");
+        }
+        auto device = entry.devices.add(address, std::uint32_t(bus));
+        entry.handles[address] = device;
+        entry.cameras[address] = camera;
+        mCameras.try_emplace(camera, &entry, address, device);
+    }
+
+    // 启动工作线程;rebalance 大于 0 时由第一个线程按该周期自动调用 rebalance()
+    void start(std::chrono::milliseconds rebalance = std::chrono::milliseconds(0)) {
+        if (mStarted.exchange(true)) {
+            return;
+        }
+        for (auto& shard : mShards) {
+            PelcoDReactor* reactor = shard->reactor.get();
+            shard->thread = std::thread([reactor] { reactor->run(); });
+        }
+        if (rebalance.count() > 0) {
+            scheduleRebalance(rebalance);
+        }
+    }
+
+    // 线程安全,设备不存在时抛出 std::out_of_range;指令经所属总线的调度器排队
+    PelcoDBusProtocol& camera(CameraId camera) {
+        return protocol(mCameras.at(camera));
+    }
+    // 在摄像机所属总线的工作线程中执行 task,适合需要连续操作同一设备且不希望跨线程的调用者;
+    // 总线迁移期间投递的任务在迁移完成后于新的线程执行
+    void post(CameraId camera, std::function<void(PelcoDBusProtocol&)> task) {
+        auto& entry = mCameras.at(camera);
+        PelcoDBusProtocol* target = &protocol(entry);
+        dispatch(*entry.bus, [target, task = std::move(task)] { task(*target); });
+    }
+
+    // 线程安全,直接在总线上排队一条查询,响应写入设备表;不会创建协议对象
+    void query(CameraId camera, PelcoDQuery query) {
+        auto& entry = mCameras.at(camera);
+        entry.bus->bus->submit(PelcoDFrame(entry.address, pelcoDQueryCommand(query)));
+    }
+    // 线程安全,设备表中缓存的 pan/tilt/zoom,未知或已因运动指令失效时返回 false
+    bool position(CameraId camera, PelcoDQuery axis, std::uint16_t& value, PelcoDDeviceTable::Clock::time_point* stamp = nullptr) {
+        auto& entry = mCameras.at(camera);
+        std::lock_guard<std::mutex> lock(entry.bus->mutex);
+        auto time = entry.bus->devices.stamp(entry.device, axis);
+        if (time == PelcoDDeviceTable::Clock::time_point()) {
+            return false;
+        }
+        value = entry.bus->devices.value(entry.device, axis);
+        if (stamp) {
+            *stamp = time;
+        }
+        return true;
+    }
+    // 线程安全,逐条总线扫描设备表,pan/tilt/zoom 任一未知或早于 staleness 的摄像机追加到 out,返回找到的数量
+    std::size_t staleCameras(std::vector<CameraId>& out, PelcoDDeviceTable::Clock::duration staleness) {
+        auto now = PelcoDDeviceTable::Clock::now();
+        std::vector<PelcoDDeviceTable::Handle> handles;
+        std::size_t before = out.size();
+        for (auto& bus : mBuses) {
+            std::lock_guard<std::mutex> lock(bus->mutex);
+            handles.clear();
+            bus->devices.stale(handles, staleness, now);
+            for (auto handle : handles) {
+                out.push_back(bus->cameras[bus->devices.address(handle)]);
+            }
+        }
+        return out.size() - before;
+    }
+
+    std::size_t workers() const {
+        return mShards.size();
+    }
+    std::size_t buses() const {
+        return mBuses.size();
+    }
+    // 总线当前所属的线程序号
+    std::size_t shardOf(BusId bus) const {
+        return mBuses.at(bus)->shard.load(std::memory_order_acquire)->index;
+    }
+    PelcoDBus& bus(BusId bus) {
+        return *mBuses.at(bus)->bus;
+    }
+    // 线程安全,把总线迁移到指定线程
+    void moveBus(BusId bus, std::size_t worker) {
+        std::lock_guard<std::mutex> lock(mRebalanceMutex);
+        move(*mBuses.at(bus), *mShards.at(worker));
+    }
+
+    /*!
+     * 按上次调用以来各总线发出与收到的帧数估计各线程的负载,
+     * 由最空闲的线程接手最繁忙线程上的总线,直至两者之差不超过平均负载的 tolerance 倍.
+     * 线程安全,返回迁移的总线数.
+     */
+    std::size_t rebalance(double tolerance = 0.25) {
+        std::lock_guard<std::mutex> lock(mRebalanceMutex);
+        std::vector<std::uint64_t> load(mShards.size(), 0);
+        std::uint64_t total = 0;
+        for (auto& bus : mBuses) {
+            auto stats = bus->bus->scheduler().stats();
+            std::uint64_t count = stats.frames + stats.responses;
+            bus->load = count - bus->counted;
+            bus->counted = count;
+            load[bus->shard.load()->index] += bus->load;
+            total += bus->load;
+        }
+        std::size_t moved = 0;
+        auto limit = std::uint64_t(tolerance * double(total) / double(mShards.size()));
+        for (std::size_t round = 0; round < mBuses.size(); ++round) {
+            auto busiest = std::size_t(std::max_element(load.begin(), load.end()) - load.begin());
+            auto idlest = std::size_t(std::min_element(load.begin(), load.end()) - load.begin());
+            std::uint64_t gap = load[busiest] - load[idlest];
+            if (gap <= limit) {
+                break;
+            }
+            // 选负载最接近差值一半的总线,迁移后两者最接近
+            BusEntry* candidate = nullptr;
+            for (auto& bus : mBuses) {
+                if (bus->shard.load()->index != busiest || bus->load == 0 || bus->load >= gap) {
+                    continue;
+                }
+                auto distance = [&](const BusEntry* entry) {
+                    return entry->load > gap / 2 ? entry->load - gap / 2 : gap / 2 - entry->load;
+                };
+                if (!candidate || distance(bus.get()) < distance(candidate)) {
+                    candidate = bus.get();
+                }
+            }
+            if (!candidate) {
+                break;
+            }
+            move(*candidate, *mShards[idlest]);
+            load[busiest] -= candidate->load;
+            load[idlest] += candidate->load;
+            ++moved;
+        }
+        return moved;
+    }
+
+private:
+    struct Shard {
+        std::size_t index = 0;
+        std::unique_ptr<PelcoDReactor> reactor;
+        std::thread thread;
+        std::size_t buses = 0;
+    };
+    struct BusEntry {
+        BusEntry() {
+            handles.fill(0xffffffff);
+        }
+
+        std::unique_ptr<PelcoDSerialPort> port;
+        std::unique_ptr<PelcoDBus> bus;
+        std::atomic<Shard*> shard {nullptr};
+        // rebalance 使用:累计帧数与上一周期的帧数
+        std::uint64_t counted = 0;
+        std::uint64_t load = 0;
+        // 迁移期间 post() 的任务暂存于此,迁移完成后交给新线程
+        std::mutex postMutex;
+        bool moving = false;
+        std::vector<std::function<void()>> deferred;
+        // 总线上的摄像机,按地址索引句柄与摄像机 ID;事件循环线程与查询者之间以 mutex 保护
+        std::mutex mutex;
+        PelcoDDeviceTable devices;
+        std::array<PelcoDDeviceTable::Handle, 256> handles;
+        std::array<CameraId, 256> cameras {};
+    };
+    struct Camera {
+        Camera(BusEntry* bus, std::uint8_t address, PelcoDDeviceTable::Handle device)
+            : bus(bus)
+            , address(address)
+            , device(device) {
+        }
+
+        BusEntry* bus;
+        std::uint8_t address;
+        PelcoDDeviceTable::Handle device;
+        // 协议对象在首次使用时创建
+        std::once_flag created;
+        std::unique_ptr<PelcoDBusProtocol> protocol;
+    };
+
+    PelcoDBusProtocol& protocol(Camera& camera) {
+        std::call_once(camera.created, [&] { camera.protocol = std::make_unique<PelcoDBusProtocol>(*camera.bus->bus, camera.address); });
+        return *camera.protocol;
+    }
+    // 总线上写出的指令与收到的查询响应记入设备表,在事件循环线程中调用
+    static void observe(BusEntry& entry, const PelcoDFrameView& frame, bool sent) {
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        auto device = entry.handles[frame.address()];
+        if (!entry.devices.contains(device)) {
+            return;
+        }
+        if (sent) {
+            entry.devices.command(device, frame.command());
+        } else {
+            entry.devices.receive(device, frame);
+        }
+    }
+
+    Shard& lightest() {
+        std::lock_guard<std::mutex> lock(mRebalanceMutex);
+        Shard* best = mShards.front().get();
+        for (auto& shard : mShards) {
+            if (shard->buses < best->buses) {
+                best = shard.get();
+            }
+        }
+        ++best->buses;
+        return *best;
+    }
+    // 总线表在 start() 之后只读,staleCameras()/bus()/shardOf() 因此无需加锁
+    void checkNotStarted() const {
+        if (mStarted) {
+            throw std::logic_error("pelco-d fleet buses must be added before start()");
+        }
+    }
+    BusId addBus(Shard& shard, std::unique_ptr<PelcoDSerialPort> port, const PelcoDBusTiming& timing) {
+        auto entry = std::make_unique<BusEntry>();
+        entry->bus = std::make_unique<PelcoDBus>(*port, timing);
+        entry->bus->observe([target = entry.get()](const PelcoDFrameView& frame, bool sent) { observe(*target, frame, sent); });
+        entry->port = std::move(port);
+        entry->shard = &shard;
+        std::lock_guard<std::mutex> lock(mRebalanceMutex);
+        mBuses.push_back(std::move(entry));
+        return mBuses.size() - 1;
+    }
+    // 调用者持有 mRebalanceMutex
+    void move(BusEntry& bus, Shard& target) {
+        Shard* source = bus.shard.load();
+        if (source == &target) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(bus.postMutex);
+            bus.moving = true;
+        }
+        bus.bus->moveTo(*target.reactor);
+        std::vector<std::function<void()>> deferred;
+        {
+            std::lock_guard<std::mutex> lock(bus.postMutex);
+            bus.shard.store(&target, std::memory_order_release);
+            bus.moving = false;
+            deferred.swap(bus.deferred);
+        }
+        for (auto& task : deferred) {
+            dispatch(bus, std::move(task));
+        }
+        --source->buses;
+        ++target.buses;
+    }
+    // 投递到总线当前所属的线程;执行前再次确认归属,投递之后总线被迁走时转交新线程
+    static void dispatch(BusEntry& bus, std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(bus.postMutex);
+        if (bus.moving) {
+            bus.deferred.push_back(std::move(task));
+            return;
+        }
+        Shard* owner = bus.shard.load(std::memory_order_acquire);
+        owner->reactor->post([&bus, owner, task = std::move(task)]() mutable {
+            // 确认之后开始的迁移会在 moveTo 中等待本轮事件循环结束,任务执行期间总线不会离开本线程
+            bool owned;
+            {
+                std::lock_guard<std::mutex> lock(bus.postMutex);
+                owned = !bus.moving && bus.shard.load(std::memory_order_relaxed) == owner;
+            }
+            if (!owned) {
+                dispatch(bus, std::move(task));
+                return;
+            }
+            task();
+        });
+    }
+    void scheduleRebalance(std::chrono::milliseconds interval) {
+        std::lock_guard<std::mutex> lock(mRebalanceMutex);
+        if (mStopping) {
+            return;
+        }
+        mRebalanceTimer = mShards.front()->reactor->schedule(interval, [this, interval] {
+            rebalance();
+            scheduleRebalance(interval);
+        });
+    }
+
+    std::vector<std::unique_ptr<Shard>> mShards;
+    std::vector<std::unique_ptr<BusEntry>> mBuses;
+    std::unordered_map<CameraId, Camera> mCameras;
+    std::mutex mRebalanceMutex;
+    PelcoDReactor::TimerId mRebalanceTimer = 0;
+    bool mStopping = false;
+    std::atomic<bool> mStarted {false};
+};
+
+#endif // __linux__
+
+#endif // PELCODTRANSPORT_HPP
@@ -0,0 +1,70 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDBench.hpp"
+
+#include <cstring>
+
+namespace {
+
+// 写入环形内存缓冲区,排除真实 I/O 的开销
+struct MemoryTransport {
+    void send(const std::uint8_t* data, std::size_t size) {
+        if (used + size > sizeof(bytes)) {
+            used = 0;
+        }
+        std::memcpy(bytes + used, data, size);
+        used += size;
+    }
+    std::uint8_t bytes[64 * 1024];
+    std::size_t used = 0;
+};
+
+class MemoryProtocol : public SimplePelcoDProtocolImpl {
+public:
+    using SimplePelcoDProtocolImpl::sendData;
+
+    MemoryTransport transport;
+
+protected:
+    virtual void sendData(PelcoDByteView data) override {
+        transport.send(data.data(), data.size());
+    }
+};
+
+constexpr int kCalls = 100000;
+
+template <typename Send>
+double perCall(Send&& send) {
+    return pelcoDBench([&] {
+        for (int i = 0; i < kCalls; ++i) {
+            send(std::uint8_t(i & 0x3f));
+        }
+    }) / kCalls;
+}
+
+} // namespace
+
+// 同一条指令经编译期策略、虚函数接口、装饰器链发送到内存的耗时
+int main() {
+    auto basic = std::make_unique<BasicPelcoDProtocol<MemoryTransport>>(0x01);
+    MemoryProtocol impl;
+    SimplePelcoDProtocol& virtualProtocol = impl;
+    SimplePelcoDDecorator decorated(&impl);
+    SimplePelcoDProtocol& chain = decorated;
+
+    std::printf("ns per call            panLeft  stopMotion  setPanPosition(float)\n");
+    std::printf("  BasicPelcoDProtocol  %7.2f  %10.2f  %21.2f\n",
+                perCall([&](std::uint8_t speed) { basic->panLeft(speed); }),
+                perCall([&](std::uint8_t) { basic->stopMotion(); }),
+                perCall([&](std::uint8_t speed) { basic->setPanPosition(float(speed)); }));
+    std::printf("  virtual interface    %7.2f  %10.2f  %21.2f\n",
+                perCall([&](std::uint8_t speed) { virtualProtocol.panLeft(speed); }),
+                perCall([&](std::uint8_t) { virtualProtocol.stopMotion(); }),
+                perCall([&](std::uint8_t speed) { virtualProtocol.setPanPosition(float(speed)); }));
+    std::printf("  decorator chain      %7.2f  %10.2f  %21.2f\n",
+                perCall([&](std::uint8_t speed) { chain.panLeft(speed); }),
+                perCall([&](std::uint8_t) { chain.stopMotion(); }),
+                perCall([&](std::uint8_t speed) { chain.setPanPosition(float(speed)); }));
+    pelcoDKeep(basic->transport().bytes[0]);
+    pelcoDKeep(impl.transport.bytes[0]);
+    return 0;
+}
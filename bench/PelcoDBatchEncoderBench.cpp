@@ -0,0 +1,80 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDBench.hpp"
+
+#include <cstring>
+
+namespace {
+
+// 把帧追加到缓冲区,计入逐条调用虚函数的全部开销
+class BufferProtocol : public SimplePelcoDProtocolImpl {
+public:
+    using SimplePelcoDProtocolImpl::sendData;
+
+    explicit BufferProtocol(std::uint8_t* out)
+        : mOut(out) {
+    }
+    void rewind() {
+        mSize = 0;
+    }
+    void setAddress(std::uint8_t address) {
+        mDeviceAddress = address;
+    }
+
+protected:
+    virtual void sendData(PelcoDByteView data) override {
+        std::memcpy(mOut + mSize, data.data(), data.size());
+        mSize += data.size();
+    }
+
+private:
+    std::uint8_t* mOut;
+    std::size_t mSize = 0;
+};
+
+} // namespace
+
+// 对 4096 个地址下发 callPreset:批量编码 vs 逐个地址调用虚函数
+int main() {
+    constexpr std::size_t kDevices = 4096;
+    std::vector<std::uint8_t> addresses(kDevices);
+    std::vector<PelcoDBatchCommand> commands(kDevices);
+    for (std::size_t i = 0; i < kDevices; ++i) {
+        addresses[i] = std::uint8_t(i % 255 + 1);
+        commands[i] = PelcoDBatchCommand(addresses[i], PelcoDCommand::CallPreset, 0x00, std::uint8_t(i));
+    }
+    std::vector<std::uint8_t> buffer(kDevices * PelcoDFrame::kSize);
+
+    std::uint8_t preset = 0;
+    double broadcast = pelcoDBench([&] {
+        PelcoDBatchEncoder::broadcast(addresses.data(), kDevices, PelcoDCommand::CallPreset, 0x00, ++preset, buffer.data(), buffer.size());
+        pelcoDKeep(buffer[0]);
+    });
+    double encode = pelcoDBench([&] {
+        PelcoDBatchEncoder::encode(commands.data(), kDevices, buffer.data(), buffer.size());
+        pelcoDKeep(buffer[0]);
+    });
+    BufferProtocol protocol(buffer.data());
+    SimplePelcoDProtocolImpl& virtualProtocol = protocol;
+    double loop = pelcoDBench([&] {
+        protocol.rewind();
+        ++preset;
+        for (std::size_t i = 0; i < kDevices; ++i) {
+            protocol.setAddress(addresses[i]);
+            virtualProtocol.callPreset(preset);
+        }
+        pelcoDKeep(buffer[0]);
+    });
+
+#if defined(PELCOD_HAS_AVX2)
+    const char* isa = "AVX2";
+#elif defined(PELCOD_HAS_SSE2)
+    const char* isa = "SSE2";
+#else
+    const char* isa = "scalar";
+#endif
+    std::printf("%zu frames per pass, %s\n", kDevices, isa);
+    std::printf("  PelcoDBatchEncoder::broadcast  %6.2f ns/frame\n", broadcast / kDevices);
+    std::printf("  PelcoDBatchEncoder::encode     %6.2f ns/frame\n", encode / kDevices);
+    std::printf("  callPreset() via virtual calls %6.2f ns/frame\n", loop / kDevices);
+    return 0;
+}
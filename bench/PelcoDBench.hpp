@@ -0,0 +1,37 @@
+#ifndef PELCODBENCH_HPP
+#define PELCODBENCH_HPP
+
+#include <chrono>
+#include <cstdio>
+
+/*!
+ * 基准测试用的最小计时工具,不依赖测试框架.
+ * pelcoDBench() 重复执行 body 至少 minTime,返回每次执行的平均纳秒数.
+ */
+template <typename T>
+inline void pelcoDKeep(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+template <typename Body>
+double pelcoDBench(Body&& body, std::chrono::milliseconds minTime = std::chrono::milliseconds(300)) {
+    using Clock = std::chrono::steady_clock;
+    // 预热一次,排除首次缺页与缓存的影响
+    body();
+    std::size_t runs = 0;
+    auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do {
+        body();
+        ++runs;
+        elapsed = Clock::now() - start;
+    } while (elapsed < minTime);
+    return std::chrono::duration<double, std::nano>(elapsed).count() / double(runs);
+}
+
+#endif // PELCODBENCH_HPP
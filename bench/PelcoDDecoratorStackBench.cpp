@@ -0,0 +1,143 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDBench.hpp"
+
+#include <cstring>
+
+namespace {
+
+// 写入环形内存缓冲区,排除真实 I/O 的开销
+struct MemoryTransport {
+    void send(const std::uint8_t* data, std::size_t size) {
+        if (used + size > sizeof(bytes)) {
+            used = 0;
+        }
+        std::memcpy(bytes + used, data, size);
+        used += size;
+    }
+    std::uint8_t bytes[64 * 1024];
+    std::size_t used = 0;
+};
+
+class MemoryProtocol : public SimplePelcoDProtocolImpl {
+public:
+    using SimplePelcoDProtocolImpl::sendData;
+
+    MemoryTransport transport;
+
+protected:
+    virtual void sendData(PelcoDByteView data) override {
+        transport.send(data.data(), data.size());
+    }
+};
+
+// 每层只计数后转发,衡量的是分层本身的开销
+template <typename Next>
+class CountingLayer : public Next {
+public:
+    using Next::Next;
+
+    void panLeft(std::uint8_t speed) {
+        ++mCalls;
+        Next::panLeft(speed);
+    }
+    void stopMotion(void) {
+        ++mCalls;
+        Next::stopMotion();
+    }
+
+private:
+    std::uint64_t mCalls = 0;
+};
+
+class CountingDecorator : public SimplePelcoDDecorator {
+public:
+    using SimplePelcoDDecorator::SimplePelcoDDecorator;
+
+    virtual void panLeft(std::uint8_t speed) override {
+        ++mCalls;
+        SimplePelcoDDecorator::panLeft(speed);
+    }
+    virtual void stopMotion(void) override {
+        ++mCalls;
+        SimplePelcoDDecorator::stopMotion();
+    }
+
+private:
+    std::uint64_t mCalls = 0;
+};
+
+template <typename Core>
+using Stack1 = PelcoDDecoratorStack<Core, CountingLayer>;
+template <typename Core>
+using Stack4 = PelcoDDecoratorStack<Core, CountingLayer, CountingLayer, CountingLayer, CountingLayer>;
+template <typename Core>
+using Stack8 = PelcoDDecoratorStack<Core, CountingLayer, CountingLayer, CountingLayer, CountingLayer, CountingLayer, CountingLayer,
+                                    CountingLayer, CountingLayer>;
+
+// 运行期装饰器链,layers 层包在 core 外面
+struct RuntimeChain {
+    MemoryProtocol core;
+    std::vector<std::unique_ptr<CountingDecorator>> layers;
+
+    explicit RuntimeChain(int count) {
+        SimplePelcoDProtocol* inner = &core;
+        for (int i = 0; i < count; ++i) {
+            layers.push_back(std::make_unique<CountingDecorator>(inner));
+            inner = layers.back().get();
+        }
+    }
+    SimplePelcoDProtocol& outer() {
+        return *layers.back();
+    }
+};
+
+constexpr int kCalls = 100000;
+
+template <typename Send>
+double perCall(Send&& send) {
+    return pelcoDBench([&] {
+        for (int i = 0; i < kCalls; ++i) {
+            send(std::uint8_t(i & 0x3f));
+        }
+    }) / kCalls;
+}
+
+template <typename Protocol>
+void report(const char* name, Protocol& protocol) {
+    std::printf("  %-34s %8.2f %11.2f\n", name, perCall([&](std::uint8_t speed) { protocol.panLeft(speed); }),
+                perCall([&](std::uint8_t) { protocol.stopMotion(); }));
+}
+
+} // namespace
+
+// 1/4/8 层编译期装饰器栈与同样层数的运行期装饰器链发送到内存的耗时
+int main() {
+    std::printf("ns per call                          panLeft  stopMotion\n");
+
+    auto basic1 = std::make_unique<Stack1<BasicPelcoDProtocol<MemoryTransport>>>(0x01);
+    auto basic4 = std::make_unique<Stack4<BasicPelcoDProtocol<MemoryTransport>>>(0x01);
+    auto basic8 = std::make_unique<Stack8<BasicPelcoDProtocol<MemoryTransport>>>(0x01);
+    report("stack over BasicPelcoDProtocol, 1", *basic1);
+    report("stack over BasicPelcoDProtocol, 4", *basic4);
+    report("stack over BasicPelcoDProtocol, 8", *basic8);
+
+    // 虚函数核心上的栈经 SimplePelcoDProtocol 接口调用,只剩入口一次虚派发
+    Stack1<MemoryProtocol> virtual1;
+    Stack4<MemoryProtocol> virtual4;
+    Stack8<MemoryProtocol> virtual8;
+    report("stack over SimplePelcoDProtocol, 1", static_cast<SimplePelcoDProtocol&>(virtual1));
+    report("stack over SimplePelcoDProtocol, 4", static_cast<SimplePelcoDProtocol&>(virtual4));
+    report("stack over SimplePelcoDProtocol, 8", static_cast<SimplePelcoDProtocol&>(virtual8));
+
+    RuntimeChain runtime1(1);
+    RuntimeChain runtime4(4);
+    RuntimeChain runtime8(8);
+    report("SimplePelcoDDecorator chain, 1", runtime1.outer());
+    report("SimplePelcoDDecorator chain, 4", runtime4.outer());
+    report("SimplePelcoDDecorator chain, 8", runtime8.outer());
+
+    pelcoDKeep(basic1->transport().bytes[0]);
+    pelcoDKeep(basic4->transport().bytes[0]);
+    pelcoDKeep(basic8->transport().bytes[0]);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDBench.hpp"
+
+#include <future>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 每个样本睡到 now + 2ms,统计醒来时刻相对截止时间的误差
+template <typename Wait>
+void measure(const char* name, int samples, Wait&& wait) {
+    std::vector<double> error;
+    error.reserve(std::size_t(samples));
+    for (int i = 0; i < samples; ++i) {
+        auto deadline = Clock::now() + std::chrono::milliseconds(2);
+        Clock::time_point woke = wait(deadline);
+        error.push_back(std::chrono::duration<double, std::micro>(woke - deadline).count());
+    }
+    std::sort(error.begin(), error.end());
+    auto at = [&](double quantile) { return error[std::min(error.size() - 1, std::size_t(quantile * double(error.size())))]; };
+    std::printf("  %-30s p50 %8.1f  p99 %8.1f  p999 %8.1f  max %8.1f us\n", name, at(0.5), at(0.99), at(0.999), error.back());
+}
+
+void run(int samples) {
+    measure("std::this_thread::sleep_for", samples, [](Clock::time_point deadline) {
+        std::this_thread::sleep_for(deadline - Clock::now());
+        return Clock::now();
+    });
+    measure("pelcoDSleepUntil", samples, [](Clock::time_point deadline) {
+        pelcoDSleepUntil(deadline);
+        return Clock::now();
+    });
+    measure("pelcoDSleepUntil spin 100us", samples, [](Clock::time_point deadline) {
+        pelcoDSleepUntil(deadline, std::chrono::microseconds(100));
+        return Clock::now();
+    });
+    measure("pelcoDSleepUntil spin 500us", samples, [](Clock::time_point deadline) {
+        pelcoDSleepUntil(deadline, std::chrono::microseconds(500));
+        return Clock::now();
+    });
+    // 异步 single* 的停止指令由时间轮发出
+    PelcoDTimerWheel wheel;
+    measure("PelcoDTimerWheel (100us tick)", samples, [&](Clock::time_point deadline) {
+        std::promise<Clock::time_point> fired;
+        wheel.schedule(deadline, [&] { fired.set_value(Clock::now()); });
+        return fired.get_future().get();
+    });
+}
+
+} // namespace
+
+// 用法:PelcoDDelayBench [负载线程数] [样本数];负载线程数默认为 CPU 数
+int main(int argc, char** argv) {
+    int load = argc > 1 ? std::atoi(argv[1]) : int(std::max(1u, std::thread::hardware_concurrency()));
+    int samples = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+    std::printf("idle, %d samples\n", samples);
+    run(samples);
+
+    std::atomic<bool> stopping {false};
+    std::vector<std::thread> spinners;
+    for (int i = 0; i < load; ++i) {
+        spinners.emplace_back([&] {
+            std::uint64_t spins = 0;
+            while (!stopping.load(std::memory_order_relaxed)) {
+                ++spins;
+            }
+            pelcoDKeep(spins);
+        });
+    }
+    std::printf("%d busy threads, %d samples\n", load, samples);
+    run(samples);
+    stopping = true;
+    for (auto& spinner : spinners) {
+        spinner.join();
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "PelcoDTransport.hpp"
+#include "PelcoDBench.hpp"
+
+#include <poll.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kCameras = 16;
+constexpr int kProducers = 4;
+
+/*!
+ * buses 条 socketpair 总线各挂 kCameras 台摄像机,全部先放到工作线程 0 上,
+ * kProducers 个线程持续下发 setPanPosition,同时每 150ms 调用一次 rebalance.
+ * 对端按 (总线, 地址) 检查序号连续,验证迁移过程中不丢帧、不乱序.
+ */
+void run(int workers, int buses, std::chrono::milliseconds duration) {
+    PelcoDBusTiming timing;
+    timing.baudRate = 100000000;
+    timing.turnaround = std::chrono::microseconds(0);
+    PelcoDFleet fleet(static_cast<std::size_t>(workers));
+    std::vector<int> peers;
+    for (int b = 0; b < buses; ++b) {
+        int sv[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv);
+        auto id = fleet.addBus(sv[0], timing);
+        fleet.bus(id).scheduler().setCoalesceMotion(false);
+        peers.push_back(sv[1]);
+        for (int c = 1; c <= kCameras; ++c) {
+            fleet.addCamera(std::uint32_t(b * 100 + c), id, std::uint8_t(c));
+        }
+    }
+    for (int b = 0; b < buses; ++b) {
+        fleet.moveBus(std::size_t(b), 0);
+    }
+    fleet.start();
+
+    std::atomic<bool> stop {false};
+    std::atomic<long> received {0};
+    std::atomic<bool> ordered {true};
+    std::thread reader([&] {
+        std::vector<pollfd> fds;
+        for (int fd : peers) {
+            fds.push_back({fd, POLLIN, 0});
+        }
+        std::vector<std::array<int, 256>> last(static_cast<std::size_t>(buses));
+        for (auto& seq : last) {
+            seq.fill(-1);
+        }
+        std::vector<std::vector<std::uint8_t>> carry(static_cast<std::size_t>(buses));
+        std::vector<std::uint8_t> data(65536);
+        for (;;) {
+            if (::poll(fds.data(), fds.size(), 50) <= 0) {
+                if (stop) {
+                    break;
+                }
+                continue;
+            }
+            for (std::size_t b = 0; b < fds.size(); ++b) {
+                if (!(fds[b].revents & POLLIN)) {
+                    continue;
+                }
+                ssize_t n = ::read(fds[b].fd, data.data(), data.size());
+                for (ssize_t i = 0; i < n; ++i) {
+                    auto& frame = carry[b];
+                    frame.push_back(data[std::size_t(i)]);
+                    if (frame.size() == PelcoDFrame::kSize) {
+                        int seq = frame[4] << 8 | frame[5];
+                        if (seq != last[b][frame[1]] + 1) {
+                            ordered = false;
+                        }
+                        last[b][frame[1]] = seq;
+                        frame.clear();
+                        ++received;
+                    }
+                }
+            }
+        }
+    });
+
+    std::atomic<long> sent {0};
+    std::atomic<int> moved {0};
+    auto start = Clock::now();
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kProducers; ++t) {
+        producers.emplace_back([&, t] {
+            std::vector<std::uint16_t> seq(std::size_t(buses * kCameras), 0);
+            auto end = Clock::now() + duration;
+            while (Clock::now() < end) {
+                for (int b = t; b < buses; b += kProducers) {
+                    for (int c = 1; c <= kCameras; ++c) {
+                        auto& next = seq[std::size_t(b * kCameras + c - 1)];
+                        fleet.camera(std::uint32_t(b * 100 + c)).setPanPosition(std::uint8_t(next >> 8), std::uint8_t(next));
+                        ++next;
+                        ++sent;
+                    }
+                }
+            }
+        });
+    }
+    std::thread balancer([&] {
+        auto end = Clock::now() + duration;
+        while (Clock::now() + std::chrono::milliseconds(150) <= end) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(150));
+            moved += int(fleet.rebalance());
+        }
+    });
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    balancer.join();
+    auto submitted = Clock::now();
+    while (received < sent && Clock::now() - submitted < std::chrono::seconds(20)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto delivered = Clock::now();
+    stop = true;
+    reader.join();
+
+    std::vector<int> perWorker(std::size_t(workers), 0);
+    for (int b = 0; b < buses; ++b) {
+        ++perWorker[fleet.shardOf(std::size_t(b))];
+    }
+    std::printf("%7d %9ld %9ld %5s %10.0f %8d  ", workers, sent.load(), received.load(), ordered ? "ok" : "BROKEN",
+                double(received) / std::chrono::duration<double>(delivered - start).count() / 1e3, moved.load());
+    for (int count : perWorker) {
+        std::printf(" %d", count);
+    }
+    std::printf("\n");
+    for (int fd : peers) {
+        ::close(fd);
+    }
+}
+
+} // namespace
+
+// 用法: PelcoDFleetBench [总线数] [最大工作线程数] [每轮毫秒]
+int main(int argc, char** argv) {
+    int buses = argc > 1 ? std::atoi(argv[1]) : 64;
+    int maxWorkers = argc > 2 ? std::atoi(argv[2]) : 4;
+    auto duration = std::chrono::milliseconds(argc > 3 ? std::atoi(argv[3]) : 1000);
+    std::printf("%d buses x %d cameras, %d producers, all buses start on worker 0\n", buses, kCameras, kProducers);
+    std::printf("workers      sent  received order  kframes/s migrated   buses per worker\n");
+    for (int workers = 1; workers <= maxWorkers; workers *= 2) {
+        run(workers, buses, duration);
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "PelcoDTransport.hpp"
+#include "PelcoDBench.hpp"
+
+#include <dlfcn.h>
+#include <sys/resource.h>
+
+#include <cstdarg>
+
+/*!
+ * 事件循环线程的系统调用计数:覆盖 libc 的 I/O 包装函数,只统计标记过的线程.
+ * io_uring 后端经 syscall() 调用 io_uring_enter,同样计入.
+ */
+namespace {
+
+std::atomic<long> gSyscalls {0};
+thread_local bool gCounted = false;
+
+template <typename Function>
+Function next(const char* name) {
+    return reinterpret_cast<Function>(::dlsym(RTLD_NEXT, name));
+}
+
+void count() {
+    if (gCounted) {
+        gSyscalls.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+extern "C" {
+ssize_t read(int fd, void* data, size_t size) {
+    static auto real = next<ssize_t (*)(int, void*, size_t)>("read");
+    count();
+    return real(fd, data, size);
+}
+ssize_t write(int fd, const void* data, size_t size) {
+    static auto real = next<ssize_t (*)(int, const void*, size_t)>("write");
+    count();
+    return real(fd, data, size);
+}
+ssize_t send(int fd, const void* data, size_t size, int flags) {
+    static auto real = next<ssize_t (*)(int, const void*, size_t, int)>("send");
+    count();
+    return real(fd, data, size, flags);
+}
+int epoll_ctl(int epfd, int op, int fd, epoll_event* event) {
+    static auto real = next<int (*)(int, int, int, epoll_event*)>("epoll_ctl");
+    count();
+    return real(epfd, op, fd, event);
+}
+int epoll_wait(int epfd, epoll_event* events, int max, int timeout) {
+    static auto real = next<int (*)(int, epoll_event*, int, int)>("epoll_wait");
+    count();
+    return real(epfd, events, max, timeout);
+}
+long syscall(long number, ...) {
+    static auto real = next<long (*)(long, ...)>("syscall");
+    va_list args;
+    va_start(args, number);
+    long a[6];
+    for (auto& arg : a) {
+        arg = va_arg(args, long);
+    }
+    va_end(args);
+    count();
+    return real(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+}
+
+namespace {
+
+int listenOnLoopback(std::uint16_t& port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::listen(fd, 4096);
+    socklen_t length = sizeof(address);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    port = ntohs(address.sin_port);
+    return fd;
+}
+
+// connections 条回环连接,每轮事件循环向每条连接写一帧,共 rounds 轮
+void run(const char* name, PelcoDReactorBackend backend, bool coalesce, std::size_t connections, int rounds) {
+    auto reactor = makePelcoDReactor(backend);
+    std::thread loop([&] {
+        gCounted = true;
+        reactor->run();
+    });
+    std::uint16_t port = 0;
+    int listener = listenOnLoopback(port);
+    PelcoDTcpOptions options;
+    options.coalesce = coalesce;
+    std::vector<std::unique_ptr<PelcoDTcpChannel>> channels;
+    std::vector<int> peers;
+    for (std::size_t i = 0; i < connections; ++i) {
+        channels.push_back(std::make_unique<PelcoDTcpChannel>(*reactor, "127.0.0.1", std::uint16_t(port), options));
+        channels.back()->open();
+        peers.push_back(::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK));
+    }
+    for (auto& channel : channels) {
+        while (!channel->isConnected()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    // 对端在另一个线程中收取,不计入系统调用数
+    std::atomic<bool> stopping {false};
+    std::atomic<long> received {0};
+    std::thread drain([&] {
+        int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        for (int peer : peers) {
+            epoll_event event {};
+            event.events = EPOLLIN;
+            event.data.fd = peer;
+            ::epoll_ctl(epfd, EPOLL_CTL_ADD, peer, &event);
+        }
+        epoll_event events[256];
+        std::vector<char> buffer(65536);
+        while (!stopping) {
+            int n = ::epoll_wait(epfd, events, 256, 10);
+            for (int i = 0; i < n; ++i) {
+                ssize_t got;
+                while ((got = ::recv(events[i].data.fd, buffer.data(), buffer.size(), MSG_DONTWAIT)) > 0) {
+                    received += got;
+                }
+            }
+        }
+        ::close(epfd);
+    });
+
+    const PelcoDFrame frame(0x01, PelcoDCommand::Left, 0x20, 0x00);
+    long before = gSyscalls.load();
+    auto start = std::chrono::steady_clock::now();
+    std::promise<void> done;
+    std::function<void(int)> round = [&](int index) {
+        for (auto& channel : channels) {
+            channel->write(frame.view());
+        }
+        if (index + 1 < rounds) {
+            reactor->post([&, index] { round(index + 1); });
+        } else {
+            done.set_value();
+        }
+    };
+    reactor->post([&] { round(0); });
+    done.get_future().wait();
+    const long expected = long(connections) * rounds * long(PelcoDFrame::kSize);
+    while (received < expected) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long syscalls = gSyscalls.load() - before;
+    stopping = true;
+    drain.join();
+
+    double frames = double(connections) * rounds;
+    std::printf("  %-28s %8.0f kframes/s  %6.3f syscalls/frame\n", name, frames / seconds / 1e3, double(syscalls) / frames);
+    channels.clear();
+    for (int peer : peers) {
+        ::close(peer);
+    }
+    ::close(listener);
+    reactor->stop();
+    loop.join();
+}
+
+} // namespace
+
+// 用法:PelcoDReactorBench [connections] [rounds],默认 2000 条连接 × 50 轮
+int main(int argc, char** argv) {
+    std::size_t connections = argc > 1 ? std::size_t(std::atol(argv[1])) : 2000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 50;
+    // 每条连接占两个描述符
+    rlimit limit {};
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    connections = std::min<std::size_t>(connections, (limit.rlim_cur - 64) / 2);
+
+    std::printf("%zu loopback connections x %d rounds, io_uring %s\n", connections, rounds,
+#if defined(PELCOD_HAS_IO_URING)
+                PelcoDUringReactor::available() ? "available" : "unavailable (falls back to epoll)"
+#else
+                "not compiled in"
+#endif
+    );
+    run("epoll, direct writes", PelcoDReactorBackend::Epoll, false, connections, rounds);
+    run("epoll, coalesced writes", PelcoDReactorBackend::Epoll, true, connections, rounds);
+    run("io_uring, batched", PelcoDReactorBackend::IoUring, true, connections, rounds);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "PelcoDTransport.hpp"
+#include "PelcoDBench.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Mode
+{
+    Write,
+    Submit,
+    Protocol,
+};
+
+/*!
+ * producers 个线程经同一通道发出共 kFrames 帧,对端在另一线程读取并检查每个生产者的帧是否保持顺序.
+ * 帧的 data_1/data_2 为 (生产者 << 10) | 序号,序号按 1024 回绕.
+ */
+constexpr int kFrames = 200000;
+
+void run(PelcoDReactor& reactor, Mode mode, int producers) {
+    int sv[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv);
+    int buffer = 4 << 20;
+    ::setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+    PelcoDSerialPort port(reactor);
+    port.open(sv[0]);
+    PelcoDSerialProtocol protocol(port);
+    const int perProducer = kFrames / producers;
+
+    bool ordered = true;
+    std::thread reader([&] {
+        std::vector<int> last(64, -1);
+        std::vector<std::uint8_t> data(65536);
+        std::uint8_t frame[PelcoDFrame::kSize];
+        std::size_t carry = 0;
+        long total = 0;
+        const long expected = long(PelcoDFrame::kSize) * perProducer * producers;
+        while (total < expected) {
+            ssize_t n = ::read(sv[1], data.data(), data.size());
+            if (n <= 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            total += n;
+            for (ssize_t i = 0; i < n; ++i) {
+                frame[carry++] = data[std::size_t(i)];
+                if (carry == PelcoDFrame::kSize) {
+                    carry = 0;
+                    int value = frame[4] << 8 | frame[5];
+                    int producer = value >> 10;
+                    if ((value & 0x3ff) != ((last[std::size_t(producer)] + 1) & 0x3ff)) {
+                        ordered = false;
+                    }
+                    last[std::size_t(producer)] = value & 0x3ff;
+                }
+            }
+        }
+    });
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < perProducer; ++i) {
+                auto value = std::uint16_t(p << 10 | (i & 0x3ff));
+                PelcoDFrame frame(0x01, PelcoDCommand::SetPanPosition, std::uint8_t(value >> 8), std::uint8_t(value));
+                switch (mode) {
+                case Mode::Write: port.write(frame.view()); break;
+                case Mode::Submit: port.submit(frame); break;
+                case Mode::Protocol: protocol.setPanPosition(frame.bytes[4], frame.bytes[5]); break;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto submitted = Clock::now();
+    reader.join();
+    auto delivered = Clock::now();
+
+    double frames = double(perProducer) * producers;
+    std::printf(" %6.0f/%-6.0f%s", frames / std::chrono::duration<double>(submitted - start).count() / 1e3,
+                frames / std::chrono::duration<double>(delivered - start).count() / 1e3, ordered ? " " : "!");
+    std::fflush(stdout);
+    port.close();
+    ::close(sv[1]);
+}
+
+} // namespace
+
+// 每格为 提交/端到端 的千帧每秒,"!" 表示某个生产者的帧乱序
+int main() {
+    PelcoDEpollReactor reactor;
+    std::thread loop([&] { reactor.run(); });
+    const int producers[] = {1, 2, 4, 8, 16, 32, 64};
+    std::printf("%d frames over a socketpair, kframes/s submitted/delivered\n%-28s", kFrames, "producers");
+    for (int count : producers) {
+        std::printf(" %13d", count);
+    }
+    std::printf("\n");
+    const std::pair<Mode, const char*> modes[] = {
+        {Mode::Write, "PelcoDChannel::write()"},
+        {Mode::Submit, "PelcoDChannel::submit()"},
+        {Mode::Protocol, "setPanPosition() (protocol)"},
+    };
+    for (auto& mode : modes) {
+        std::printf("%-28s", mode.second);
+        for (int count : producers) {
+            run(reactor, mode.first, count);
+        }
+        std::printf("\n");
+    }
+    reactor.stop();
+    loop.join();
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+#include <mutex>
+#include <thread>
+
+namespace {
+
+class RecordingProtocol : public SimplePelcoDProtocolImpl {
+public:
+    std::vector<std::vector<std::uint8_t>> frames() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFrames;
+    }
+
+protected:
+    using SimplePelcoDProtocolImpl::sendData;
+    void sendData(PelcoDByteView data) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFrames.emplace_back(data.begin(), data.end());
+    }
+
+private:
+    std::mutex mMutex;
+    std::vector<std::vector<std::uint8_t>> mFrames;
+};
+
+// 非标校验:和取反
+class VendorChecksum : public RecordingProtocol {
+protected:
+    std::uint8_t checkSum(const std::vector<std::uint8_t>& data) override {
+        return std::uint8_t(~RecordingProtocol::checkSum(data));
+    }
+};
+
+// 非标魔术头:固定地址 0x01
+class FixedMagic : public RecordingProtocol {
+protected:
+    std::vector<std::uint8_t> magic() override {
+        return {0xff, 0x01};
+    }
+};
+
+void infraredUsesExplicitAddress() {
+    RecordingProtocol protocol;
+    protocol.setAnyValue(0, std::uint8_t(0x05));
+    protocol.infraredZoomIn();
+    protocol.infraredZoomOut();
+    auto frames = protocol.frames();
+    PELCOD_CHECK(frames.size() == 2);
+    for (const auto& frame : frames) {
+        PELCOD_CHECK(frame.size() == 7 && frame[1] == 0x02);
+    }
+    PELCOD_CHECK(std::any_cast<std::uint8_t>(protocol.getAnyValue(0)) == 0x05);
+}
+
+void vendorInfraredRewritesAddress() {
+    VendorChecksum protocol;
+    protocol.setAnyValue(0, std::uint8_t(0x05));
+    protocol.infraredZoomIn();
+    auto frames = protocol.frames();
+    PELCOD_CHECK(frames.size() == 1);
+    PELCOD_CHECK(!frames.empty() && frames[0][1] == 0x02);
+    PELCOD_CHECK(!frames.empty() && frames[0][6] == std::uint8_t(~(0x02 + frames[0][2] + frames[0][3])));
+}
+
+void probeFollowsAddressChanges() {
+    FixedMagic protocol;
+    protocol.panLeft(0x20);
+    protocol.setAnyValue(0, std::uint8_t(0x05));
+    protocol.panLeft(0x20);
+    auto frames = protocol.frames();
+    PELCOD_CHECK(frames.size() == 2);
+    // 地址 0x01 时与标准帧一致;换成 0x05 后应走非标魔术头,仍为 0x01
+    for (const auto& frame : frames) {
+        PELCOD_CHECK(frame.size() == 7 && frame[1] == 0x01);
+    }
+}
+
+void concurrentSendsKeepAddress() {
+    RecordingProtocol protocol;
+    protocol.setAnyValue(0, std::uint8_t(0x01));
+    std::thread infrared([&] {
+        for (int i = 0; i < 20000; ++i) {
+            protocol.infraredZoomIn();
+        }
+    });
+    for (int i = 0; i < 20000; ++i) {
+        protocol.panLeft(0x20);
+    }
+    infrared.join();
+    std::size_t pan = 0;
+    std::size_t misrouted = 0;
+    for (const auto& frame : protocol.frames()) {
+        if (frame[3] == std::uint8_t(PelcoDCommand::Left)) {
+            ++pan;
+            misrouted += frame[1] != 0x01;
+        }
+    }
+    PELCOD_CHECK(pan == 20000);
+    PELCOD_CHECK(misrouted == 0);
+}
+
+} // namespace
+
+int main() {
+    infraredUsesExplicitAddress();
+    vendorInfraredRewritesAddress();
+    probeFollowsAddressChanges();
+    concurrentSendsKeepAddress();
+    return pelcoDTestResult("PelcoDAddressTest");
+}
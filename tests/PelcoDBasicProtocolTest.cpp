@@ -0,0 +1,84 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+namespace {
+
+struct Recorder {
+    void send(const std::uint8_t* data, std::size_t size) {
+        bytes.insert(bytes.end(), data, data + size);
+    }
+    std::vector<std::uint8_t> bytes;
+};
+
+class RecordingProtocol : public SimplePelcoDProtocolImpl {
+public:
+    using SimplePelcoDProtocolImpl::sendData;
+
+    std::vector<std::uint8_t> bytes;
+
+protected:
+    virtual void sendData(PelcoDByteView data) override {
+        bytes.insert(bytes.end(), data.begin(), data.end());
+    }
+};
+
+// 异或校验,检验 Checksum 策略确实被使用
+struct XorChecksum {
+    static std::uint8_t compute(const std::uint8_t* frame) {
+        return std::uint8_t(frame[1] ^ frame[2] ^ frame[3] ^ frame[4] ^ frame[5]);
+    }
+};
+
+template <typename Protocol>
+void sendAll(Protocol& protocol) {
+    protocol.panLeft(0x20);
+    protocol.panRight(0x50);
+    protocol.tiltUp(0x10);
+    protocol.tiltDown(0x3f);
+    protocol.moveLeftUp(0x08);
+    protocol.moveRightDown(0x30);
+    protocol.stopMotion();
+    protocol.focusNear();
+    protocol.zoomIn();
+    protocol.irisClose();
+    protocol.setPreset(0x05);
+    protocol.clearPreset(0x05);
+    protocol.callPreset(0x05);
+    protocol.setPanPosition(45.5f);
+    protocol.setTiltPosition(-30.f);
+    protocol.setZoomPosition(0.5f);
+    protocol.setPanPosition(std::uint16_t(12345));
+    protocol.queryPanPosition();
+    protocol.queryMagnification();
+}
+
+// 编译期策略的实现与虚函数接口发出的字节完全一致
+void basicMatchesVirtualInterface() {
+    BasicPelcoDProtocol<Recorder> basic(0x07);
+    RecordingProtocol impl;
+    impl.setAnyValue(0, std::uint8_t(0x07));
+    sendAll(basic);
+    sendAll(impl);
+    PELCOD_CHECK(!basic.transport().bytes.empty());
+    PELCOD_CHECK(basic.transport().bytes == impl.bytes);
+}
+
+void checksumPolicyIsUsed() {
+    BasicPelcoDProtocol<Recorder, PelcoDStandardHeader, XorChecksum> basic(0x03);
+    basic.stopMotion();
+    basic.setPanPosition(std::uint16_t(0x1234));
+    const auto& bytes = basic.transport().bytes;
+    PELCOD_CHECK(bytes.size() == 2 * PelcoDFrame::kSize);
+    for (std::size_t i = 0; i + PelcoDFrame::kSize <= bytes.size(); i += PelcoDFrame::kSize) {
+        PELCOD_CHECK(bytes[i] == 0xff && bytes[i + 1] == 0x03);
+        PELCOD_CHECK(bytes[i + 6] == XorChecksum::compute(bytes.data() + i));
+    }
+}
+
+} // namespace
+
+int main() {
+    basicMatchesVirtualInterface();
+    checksumPolicyIsUsed();
+    return pelcoDTestResult("PelcoDBasicProtocolTest");
+}
@@ -0,0 +1,50 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+#include <cstring>
+#include <random>
+
+namespace {
+
+// 各长度下批量编码与逐帧构造的结果一致,且不写出缓冲区容量之外
+void encodeMatchesSingleFrames() {
+    std::mt19937 rng(1);
+    for (std::size_t count = 0; count < 40; ++count) {
+        std::vector<PelcoDBatchCommand> commands(count);
+        for (auto& command : commands) {
+            command = PelcoDBatchCommand(std::uint8_t(rng()), PelcoDCommand(rng()), std::uint8_t(rng()), std::uint8_t(rng()));
+        }
+        std::vector<std::uint8_t> out(count * PelcoDFrame::kSize + 3, 0xaa);
+        PELCOD_CHECK(PelcoDBatchEncoder::encode(commands.data(), count, out.data(), count * PelcoDFrame::kSize) == count);
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto& command = commands[i];
+            PelcoDFrame frame(command.address, command.cmd_1, command.cmd_2, command.data_1, command.data_2);
+            PELCOD_CHECK(std::memcmp(frame.data(), out.data() + i * PelcoDFrame::kSize, PelcoDFrame::kSize) == 0);
+        }
+        PELCOD_CHECK(out[count * PelcoDFrame::kSize] == 0xaa);
+    }
+}
+
+// 缓冲区不足时只编码能容纳的整帧
+void broadcastStopsAtCapacity() {
+    std::uint8_t addresses[10];
+    for (std::uint8_t i = 0; i < 10; ++i) {
+        addresses[i] = std::uint8_t(i + 1);
+    }
+    std::vector<std::uint8_t> out(10 * PelcoDFrame::kSize, 0xaa);
+    std::size_t capacity = 6 * PelcoDFrame::kSize + 5;
+    PELCOD_CHECK(PelcoDBatchEncoder::broadcast(addresses, 10, PelcoDCommand::CallPreset, 0x00, 0x07, out.data(), capacity) == 6);
+    for (std::size_t i = 0; i < 6; ++i) {
+        PelcoDFrame frame(addresses[i], PelcoDCommand::CallPreset, 0x00, 0x07);
+        PELCOD_CHECK(std::memcmp(frame.data(), out.data() + i * PelcoDFrame::kSize, PelcoDFrame::kSize) == 0);
+    }
+    PELCOD_CHECK(out[6 * PelcoDFrame::kSize] == 0xaa);
+}
+
+} // namespace
+
+int main() {
+    encodeMatchesSingleFrames();
+    broadcastStopsAtCapacity();
+    return pelcoDTestResult("PelcoDBatchEncoderTest");
+}
@@ -0,0 +1,66 @@
+#include "PelcoDTransport.hpp"
+#include "PelcoDTest.hpp"
+
+namespace {
+
+// 从对端读取一个完整帧,超时返回 false
+bool readFrame(int fd, PelcoDFrame& frame) {
+    std::size_t got = 0;
+    while (got < PelcoDFrame::kSize) {
+        pollfd p {fd, POLLIN, 0};
+        if (::poll(&p, 1, 2000) <= 0) {
+            return false;
+        }
+        ssize_t n = ::read(fd, frame.bytes.data() + got, PelcoDFrame::kSize - got);
+        if (n <= 0) {
+            return false;
+        }
+        got += std::size_t(n);
+    }
+    return true;
+}
+
+void respond(int fd, std::uint8_t address, std::uint16_t value) {
+    PelcoDFrame response(address, PelcoDCommand::QueryPanPositionResponse, std::uint8_t(value >> 8), std::uint8_t(value));
+    PELCOD_CHECK(::write(fd, response.data(), PelcoDFrame::kSize) == ssize_t(PelcoDFrame::kSize));
+}
+
+void responsesFollowAddressChange() {
+    PelcoDEpollReactor reactor;
+    std::thread loop([&] { reactor.run(); });
+    int sv[2];
+    PELCOD_CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) == 0);
+    {
+        PelcoDSerialPort port(reactor);
+        port.open(sv[0]);
+        PelcoDBusTiming timing;
+        timing.baudRate = 115200;
+        PelcoDBus bus(port, timing);
+        {
+            PelcoDBusProtocol camera(bus, 0x01);
+            camera.setAnyValue(0, std::uint8_t(0x07));
+            auto pan = camera.asyncQuery(PelcoDQuery::Pan);
+            PelcoDFrame query;
+            PELCOD_CHECK(readFrame(sv[1], query));
+            PELCOD_CHECK(query.bytes[1] == 0x07);
+            respond(sv[1], 0x07, 0x1234);
+            PELCOD_CHECK(pan.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+            PELCOD_CHECK(pan.get() == 0x1234);
+        }
+        // 摄像机已析构,新旧地址上的响应都不应再分发给它
+        respond(sv[1], 0x07, 0x0001);
+        respond(sv[1], 0x01, 0x0002);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        port.close();
+    }
+    ::close(sv[1]);
+    reactor.stop();
+    loop.join();
+}
+
+} // namespace
+
+int main() {
+    responsesFollowAddressChange();
+    return pelcoDTestResult("PelcoDBusAddressTest");
+}
@@ -0,0 +1,296 @@
+#include "PelcoDScheduler.hpp"
+#include "PelcoDTest.hpp"
+
+#include <vector>
+
+namespace {
+
+using Clock = PelcoDBusScheduler::Clock;
+using std::chrono::microseconds;
+
+// 记录 poll 交给线路的帧
+struct Wire {
+    std::vector<PelcoDFrame> frames;
+
+    void operator()(const PelcoDFrame& frame) {
+        frames.push_back(frame);
+    }
+    std::uint8_t address(std::size_t i) const {
+        return frames[i].bytes[1];
+    }
+    PelcoDCommand command(std::size_t i) const {
+        return PelcoDFrameView(frames[i].data()).command();
+    }
+};
+
+PelcoDBusTiming fastTiming() {
+    PelcoDBusTiming timing;
+    timing.baudRate = 9600;
+    timing.turnaround = microseconds(2000);
+    return timing;
+}
+
+// 线上时间按起始位 + 数据位 + 校验位 + 停止位向上取整到微秒
+void frameTimeFollowsLineSettings() {
+    PelcoDBusTiming timing;
+    PELCOD_CHECK(timing.bitsPerByte() == 10);
+    PELCOD_CHECK(timing.frameTime() == microseconds(29167));
+    PELCOD_CHECK(timing.responseWindow() == microseconds(5000 + 29167));
+
+    timing.baudRate = 9600;
+    timing.parity = true;
+    timing.stopBits = 2;
+    PELCOD_CHECK(timing.bitsPerByte() == 12);
+    PELCOD_CHECK(timing.frameTime() == microseconds(8750));
+}
+
+// 一帧的线上时间加保护间隔结束之前不发下一帧
+void framesArePacedByBaudRate() {
+    PelcoDBusTiming timing;
+    timing.guard = microseconds(1000);
+    PelcoDBusScheduler scheduler(timing);
+    Wire wire;
+    auto t0 = Clock::now();
+    PELCOD_CHECK(scheduler.poll(wire, t0) == Clock::time_point::max());
+
+    for (std::uint8_t preset = 1; preset <= 3; ++preset) {
+        scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::CallPreset, 0x00, preset));
+    }
+    auto slot = microseconds(29167 + 1000);
+    PELCOD_CHECK(scheduler.poll(wire, t0) == t0 + slot);
+    PELCOD_CHECK(wire.frames.size() == 1);
+    PELCOD_CHECK(scheduler.poll(wire, t0 + slot - microseconds(1)) == t0 + slot);
+    PELCOD_CHECK(wire.frames.size() == 1);
+    PELCOD_CHECK(scheduler.poll(wire, t0 + slot) == t0 + 2 * slot);
+    PELCOD_CHECK(scheduler.poll(wire, t0 + 2 * slot) == t0 + 3 * slot);
+    PELCOD_CHECK(wire.frames.size() == 3);
+    PELCOD_CHECK(wire.frames[2].bytes[5] == 3);
+    PELCOD_CHECK(scheduler.poll(wire, t0 + 3 * slot) == Clock::time_point::max());
+
+    auto stats = scheduler.stats();
+    PELCOD_CHECK(stats.frames == 3);
+    PELCOD_CHECK(stats.busy == 3 * slot);
+    PELCOD_CHECK(scheduler.pending() == 0);
+}
+
+// 同一优先级内各地址轮转,每个地址内保持提交顺序
+void addressesTakeTurns() {
+    PelcoDBusScheduler scheduler(fastTiming());
+    for (std::uint8_t preset = 1; preset <= 3; ++preset) {
+        scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::CallPreset, 0x00, preset));
+        scheduler.submit(PelcoDFrame(0x02, PelcoDCommand::CallPreset, 0x00, preset));
+    }
+    scheduler.submit(PelcoDFrame(0x03, PelcoDCommand::CallPreset, 0x00, 0x01));
+    PELCOD_CHECK(scheduler.pending() == 7);
+    PELCOD_CHECK(scheduler.pending(0x01) == 3);
+
+    Wire wire;
+    auto now = Clock::now();
+    while (scheduler.pending() > 0) {
+        now = scheduler.poll(wire, now);
+    }
+    const std::uint8_t addresses[] = {1, 2, 3, 1, 2, 1, 2};
+    const std::uint8_t presets[] = {1, 1, 1, 2, 2, 3, 3};
+    PELCOD_CHECK(wire.frames.size() == 7);
+    for (std::size_t i = 0; i < wire.frames.size() && i < 7; ++i) {
+        PELCOD_CHECK(wire.address(i) == addresses[i]);
+        PELCOD_CHECK(wire.frames[i].bytes[5] == presets[i]);
+    }
+}
+
+// 查询帧为响应预留窗口,对应地址的响应提前结束窗口,没有响应则窗口结束时计为超时
+void queriesReserveResponseWindow() {
+    auto timing = fastTiming();
+    PelcoDBusScheduler scheduler(timing);
+    Wire wire;
+    auto t0 = Clock::now();
+    auto frame = timing.frameTime();
+
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::QueryPanPosition, 0x00, 0x00));
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::CallPreset, 0x00, 0x01));
+    PELCOD_CHECK(scheduler.poll(wire, t0) == t0 + frame + timing.responseWindow());
+
+    // 其他地址的响应不结束窗口
+    auto early = t0 + frame + microseconds(500);
+    scheduler.responseReceived(0x02, early);
+    PELCOD_CHECK(scheduler.busyUntil() == t0 + frame + timing.responseWindow());
+    scheduler.responseReceived(0x01, early);
+    PELCOD_CHECK(scheduler.busyUntil() == early);
+    PELCOD_CHECK(scheduler.poll(wire, early) == early + frame);
+    PELCOD_CHECK(wire.frames.size() == 2);
+
+    auto stats = scheduler.stats();
+    PELCOD_CHECK(stats.queries == 1 && stats.responses == 1 && stats.responseTimeouts == 0);
+    PELCOD_CHECK(stats.busy == microseconds(500) + 2 * frame);
+
+    // 无响应:窗口结束后的下一次 poll 记为超时
+    scheduler.submit(PelcoDFrame(0x02, PelcoDCommand::QueryTiltPosition, 0x00, 0x00));
+    auto t1 = early + frame;
+    auto end = scheduler.poll(wire, t1);
+    PELCOD_CHECK(end == t1 + frame + timing.responseWindow());
+    // 窗口未结束时即使没有待发帧也要再次 poll,以便记录超时
+    PELCOD_CHECK(scheduler.poll(wire, t1 + frame) == end);
+    PELCOD_CHECK(scheduler.poll(wire, end) == Clock::time_point::max());
+    scheduler.responseReceived(0x02, end);
+    stats = scheduler.stats();
+    PELCOD_CHECK(stats.queries == 2 && stats.responses == 1 && stats.responseTimeouts == 1);
+}
+
+// 停止先于运动,运动先于查询与预置位,与提交顺序和地址无关
+void higherPriorityGoesFirst() {
+    PelcoDBusScheduler scheduler(fastTiming());
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::CallPreset, 0x00, 0x01));
+    scheduler.submit(PelcoDFrame(0x02, PelcoDCommand::QueryPanPosition, 0x00, 0x00));
+    scheduler.submit(PelcoDFrame(0x03, PelcoDCommand::Left, 0x20, 0x00));
+    scheduler.submit(PelcoDFrame(0x04, PelcoDCommand::Stop, 0x00, 0x00));
+
+    Wire wire;
+    auto now = Clock::now();
+    while (scheduler.pending() > 0) {
+        now = scheduler.poll(wire, now);
+    }
+    PELCOD_CHECK(wire.frames.size() == 4);
+    if (wire.frames.size() != 4) {
+        return;
+    }
+    PELCOD_CHECK(wire.address(0) == 0x04 && wire.command(0) == PelcoDCommand::Stop);
+    PELCOD_CHECK(wire.address(1) == 0x03 && wire.command(1) == PelcoDCommand::Left);
+    PELCOD_CHECK(wire.address(2) == 0x01 && wire.address(3) == 0x02);
+    PELCOD_CHECK(scheduler.stats().preempted == 0);
+}
+
+// 停止只作废同一地址排队中的连续运动,Camera On/Off 等开关类指令保留并按原顺序发送
+void stopPreemptsOnlyContinuousMotion() {
+    PelcoDBusScheduler scheduler(fastTiming());
+    scheduler.setCoalesceMotion(false);
+    scheduler.submit(PelcoDFrame(0x01, 0x88, 0x00, 0x00, 0x00));
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::Left, 0x20, 0x00));
+    scheduler.submit(PelcoDFrame(0x01, 0x08, 0x00, 0x00, 0x00));
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::Up, 0x00, 0x20));
+    scheduler.submit(PelcoDFrame(0x02, PelcoDCommand::Right, 0x20, 0x00));
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::Stop, 0x00, 0x00));
+    // 停止之后提交的帧排在保留下来的开关类指令之后
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::Down, 0x00, 0x10));
+    PELCOD_CHECK(scheduler.stats().preempted == 2);
+    PELCOD_CHECK(scheduler.pending(0x01) == 4);
+
+    Wire wire;
+    auto now = Clock::now();
+    while (scheduler.pending() > 0) {
+        now = scheduler.poll(wire, now);
+    }
+    PELCOD_CHECK(wire.frames.size() == 5);
+    if (wire.frames.size() != 5) {
+        return;
+    }
+    PELCOD_CHECK(wire.address(0) == 0x01 && wire.command(0) == PelcoDCommand::Stop);
+    PELCOD_CHECK(wire.address(1) == 0x01 && wire.frames[1].bytes[2] == 0x88);
+    PELCOD_CHECK(wire.address(2) == 0x02 && wire.command(2) == PelcoDCommand::Right);
+    PELCOD_CHECK(wire.address(3) == 0x01 && wire.frames[3].bytes[2] == 0x08);
+    PELCOD_CHECK(wire.address(4) == 0x01 && wire.command(4) == PelcoDCommand::Down);
+}
+
+// 后到的连续运动帧原位覆盖同地址尚未发出的运动帧,开关类指令不参与覆盖
+void motionFramesCoalesce() {
+    PelcoDBusScheduler scheduler(fastTiming());
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::Left, 0x10, 0x00));
+    scheduler.submit(PelcoDFrame(0x02, PelcoDCommand::Right, 0x10, 0x00));
+    scheduler.submit(PelcoDFrame(0x01, 0x88, 0x00, 0x00, 0x00));
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::Left, 0x20, 0x00));
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::Left | PelcoDCommand::Up, 0x30, 0x30));
+    PELCOD_CHECK(scheduler.stats().coalesced == 2);
+    PELCOD_CHECK(scheduler.pending(0x01) == 2);
+
+    Wire wire;
+    auto now = Clock::now();
+    while (scheduler.pending() > 0) {
+        now = scheduler.poll(wire, now);
+    }
+    // 覆盖后的帧保留第一帧已排到的轮转位置
+    PELCOD_CHECK(wire.frames.size() == 3);
+    if (wire.frames.size() != 3) {
+        return;
+    }
+    PELCOD_CHECK(wire.address(0) == 0x01 && wire.command(0) == (PelcoDCommand::Left | PelcoDCommand::Up));
+    PELCOD_CHECK(wire.frames[0].bytes[4] == 0x30);
+    PELCOD_CHECK(wire.address(1) == 0x02);
+    PELCOD_CHECK(wire.address(2) == 0x01 && wire.frames[2].bytes[2] == 0x88);
+
+    // 关闭后逐帧发送
+    scheduler.setCoalesceMotion(false);
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::Left, 0x10, 0x00));
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::Left, 0x20, 0x00));
+    PELCOD_CHECK(scheduler.pending(0x01) == 2);
+    PELCOD_CHECK(scheduler.stats().coalesced == 2);
+}
+
+// 刷新间隔内与上次发出的帧相同则跳过,超过间隔强制重发;查询帧与其他地址不受影响
+void duplicatesAreSuppressedUntilRefresh() {
+    auto timing = fastTiming();
+    PelcoDBusScheduler scheduler(timing);
+    Wire wire;
+    auto t0 = Clock::now();
+    auto frame = timing.frameTime();
+    PelcoDFrame preset(0x01, PelcoDCommand::CallPreset, 0x00, 0x01);
+
+    // 默认关闭
+    scheduler.submit(preset);
+    scheduler.submit(preset);
+    scheduler.poll(wire, t0);
+    scheduler.poll(wire, t0 + frame);
+    PELCOD_CHECK(wire.frames.size() == 2);
+
+    auto refresh = std::chrono::milliseconds(100);
+    scheduler.setSuppressDuplicates(refresh);
+    auto t1 = t0 + 2 * frame;
+    scheduler.submit(preset);
+    PELCOD_CHECK(scheduler.poll(wire, t1) == t1 + frame);
+    scheduler.submit(preset);
+    scheduler.submit(PelcoDFrame(0x02, PelcoDCommand::CallPreset, 0x00, 0x01));
+    // 跳过的帧不占用线路,同一次 poll 接着发出下一帧
+    PELCOD_CHECK(scheduler.poll(wire, t1 + frame) == t1 + 2 * frame);
+    PELCOD_CHECK(wire.frames.size() == 4 && wire.address(3) == 0x02);
+    auto stats = scheduler.stats();
+    PELCOD_CHECK(stats.suppressed == 1 && stats.saved == frame);
+    PELCOD_CHECK(stats.frames == 4);
+
+    // 不同的帧照常发出并成为新的比较对象
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::CallPreset, 0x00, 0x02));
+    scheduler.poll(wire, t1 + 2 * frame);
+    PELCOD_CHECK(wire.frames.size() == 5);
+
+    // 查询帧从不跳过
+    auto t2 = t1 + 3 * frame;
+    for (int i = 0; i < 2; ++i) {
+        scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::QueryPanPosition, 0x00, 0x00));
+        scheduler.poll(wire, t2);
+        scheduler.responseReceived(0x01, t2 + frame);
+        t2 += frame;
+    }
+    PELCOD_CHECK(wire.frames.size() == 7);
+
+    // 距上次实际发出超过刷新间隔后强制重发
+    auto t3 = t1 + 2 * frame + refresh;
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::CallPreset, 0x00, 0x02));
+    scheduler.poll(wire, t3 - microseconds(1));
+    PELCOD_CHECK(wire.frames.size() == 7);
+    scheduler.submit(PelcoDFrame(0x01, PelcoDCommand::CallPreset, 0x00, 0x02));
+    scheduler.poll(wire, t3);
+    PELCOD_CHECK(wire.frames.size() == 8);
+    PELCOD_CHECK(scheduler.stats().suppressed == 2);
+    PELCOD_CHECK(scheduler.pending() == 0);
+}
+
+} // namespace
+
+int main() {
+    frameTimeFollowsLineSettings();
+    framesArePacedByBaudRate();
+    addressesTakeTurns();
+    queriesReserveResponseWindow();
+    higherPriorityGoesFirst();
+    stopPreemptsOnlyContinuousMotion();
+    motionFramesCoalesce();
+    duplicatesAreSuppressedUntilRefresh();
+    return pelcoDTestResult("PelcoDBusSchedulerTest");
+}
@@ -0,0 +1,125 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+struct MemoryTransport {
+    std::vector<std::array<std::uint8_t, PelcoDFrame::kSize>> frames;
+
+    void send(const std::uint8_t* data, std::size_t size) {
+        std::array<std::uint8_t, PelcoDFrame::kSize> frame {};
+        std::copy(data, data + std::min(size, PelcoDFrame::kSize), frame.begin());
+        frames.push_back(frame);
+    }
+};
+
+std::vector<std::string>& calls() {
+    static std::vector<std::string> log;
+    return log;
+}
+
+// 记录经过本层的 stopMotion 与 setPanPosition,Tag 区分各层
+template <char Tag>
+struct Recording {
+    template <typename Next>
+    class Layer : public Next {
+    public:
+        using Next::Next;
+        // 其余重载照常可见
+        using Next::setPanPosition;
+
+        void stopMotion(void) {
+            calls().push_back(std::string(1, Tag) + ":stop");
+            Next::stopMotion();
+        }
+        void setPanPosition(std::uint8_t msb, std::uint8_t lsb) {
+            calls().push_back(std::string(1, Tag) + ":pan");
+            Next::setPanPosition(msb, lsb);
+        }
+    };
+};
+
+template <typename Next>
+using OuterLayer = Recording<'o'>::Layer<Next>;
+template <typename Next>
+using InnerLayer = Recording<'i'>::Layer<Next>;
+
+using BasicStack = PelcoDDecoratorStack<BasicPelcoDProtocol<MemoryTransport>, OuterLayer, InnerLayer>;
+
+const std::vector<std::string> kStopThroughBothLayers {"o:stop", "i:stop"};
+const std::vector<std::string> kPanThroughBothLayers {"o:pan", "i:pan"};
+
+// 直接调用与指令集内部发起的调用都从最外层进入,逐层向内
+void basicCoreDispatchesThroughEveryLayer() {
+    BasicStack ptz(0x01);
+    calls().clear();
+    ptz.stopMotion();
+    PELCOD_CHECK(calls() == kStopThroughBothLayers);
+
+    // single* 脉冲结束时发出的停止
+    calls().clear();
+    ptz.singlePanLeft(0x20, 0);
+    PELCOD_CHECK(calls() == kStopThroughBothLayers);
+    PELCOD_CHECK(ptz.transport().frames.size() == 3);
+    PELCOD_CHECK(PelcoDFrameView(ptz.transport().frames.back().data()).command() == PelcoDCommand::Stop);
+
+    // 16 位与浮点便捷重载最终调用被拦截的字节版本
+    calls().clear();
+    ptz.setPanPosition(std::uint16_t(0x1234));
+    PELCOD_CHECK(calls() == kPanThroughBothLayers);
+    calls().clear();
+    ptz.setPanPosition(std::float_t(90.0f));
+    PELCOD_CHECK(calls() == kPanThroughBothLayers);
+    const auto& frame = ptz.transport().frames.back();
+    PELCOD_CHECK(frame == PelcoDFrame(0x01, PelcoDCommand::SetPanPosition, 0x23, 0x28).bytes);
+}
+
+// 没有装饰层时与直接使用 Core 发出相同的字节
+void emptyStackMatchesCore() {
+    PelcoDDecoratorStack<BasicPelcoDProtocol<MemoryTransport>> stacked(0x05);
+    BasicPelcoDProtocol<MemoryTransport> core(0x05);
+    stacked.singleTiltUp(0x10, 0);
+    core.singleTiltUp(0x10, 0);
+    stacked.setZoomPosition(std::uint16_t(0x0102));
+    core.setZoomPosition(std::uint16_t(0x0102));
+    PELCOD_CHECK(stacked.transport().frames.size() == 3);
+    PELCOD_CHECK(stacked.transport().frames == core.transport().frames);
+}
+
+class MemoryProtocol : public SimplePelcoDProtocolImpl {
+public:
+    std::vector<PelcoDFrame> frames;
+
+protected:
+    using SimplePelcoDProtocolImpl::sendData;
+    void sendData(PelcoDByteView data) override {
+        PelcoDFrame frame;
+        std::copy(data.begin(), data.end(), frame.bytes.begin());
+        frames.push_back(frame);
+    }
+};
+
+// 虚函数核心经由虚派发到达最外层,结果仍可当作 SimplePelcoDProtocol 使用
+void virtualCoreDispatchesThroughEveryLayer() {
+    PelcoDDecoratorStack<MemoryProtocol, OuterLayer, InnerLayer> ptz;
+    SimplePelcoDProtocol& base = ptz;
+    calls().clear();
+    base.setPanPosition(std::float_t(90.0f));
+    PELCOD_CHECK(calls() == kPanThroughBothLayers);
+    calls().clear();
+    base.stopMotion();
+    PELCOD_CHECK(calls() == kStopThroughBothLayers);
+    PELCOD_CHECK(ptz.frames.size() == 2);
+}
+
+} // namespace
+
+int main() {
+    basicCoreDispatchesThroughEveryLayer();
+    emptyStackMatchesCore();
+    virtualCoreDispatchesThroughEveryLayer();
+    return pelcoDTestResult("PelcoDDecoratorStackTest");
+}
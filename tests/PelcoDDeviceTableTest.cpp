@@ -0,0 +1,57 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+namespace {
+
+using Clock = PelcoDDeviceTable::Clock;
+
+void fill(PelcoDDeviceTable& table, PelcoDDeviceTable::Handle handle, Clock::time_point when) {
+    for (auto axis : {PelcoDQuery::Pan, PelcoDQuery::Tilt, PelcoDQuery::Zoom}) {
+        table.update(handle, axis, 100, when);
+    }
+}
+
+// 闲置超过 uint32 毫秒回绕周期(约 49.7 天)的设备仍判定为过期
+void longIdleDevicesAreStale() {
+    PelcoDDeviceTable table;
+    auto start = Clock::now();
+    std::vector<PelcoDDeviceTable::Handle> handles;
+    for (std::uint8_t address = 1; address <= 11; ++address) {
+        handles.push_back(table.add(address));
+        fill(table, handles.back(), start + std::chrono::seconds(1));
+    }
+    auto later = start + std::chrono::seconds(1) + std::chrono::milliseconds(std::int64_t(1) << 32);
+    // 一台最近刷新过,其余停留在 49.7 天前
+    fill(table, handles[5], later);
+    std::vector<PelcoDDeviceTable::Handle> out;
+    PELCOD_CHECK(table.stale(out, std::chrono::minutes(1), later) == handles.size() - 1);
+    PELCOD_CHECK(std::find(out.begin(), out.end(), handles[5]) == out.end());
+    PELCOD_CHECK(table.stamp(handles[5], PelcoDQuery::Pan) - later < std::chrono::milliseconds(1));
+}
+
+// 未知的轴与运动指令之后失效的轴都算过期,按列下标顺序返回
+void unknownAndMovedAxesAreStale() {
+    PelcoDDeviceTable table;
+    auto now = Clock::now();
+    std::vector<PelcoDDeviceTable::Handle> handles;
+    for (std::uint8_t address = 1; address <= 9; ++address) {
+        handles.push_back(table.add(address));
+        fill(table, handles.back(), now);
+    }
+    table.command(handles[2], PelcoDCommand::Left, now);
+    auto partial = table.add(10);
+    table.update(partial, PelcoDQuery::Pan, 1, now);
+    std::vector<PelcoDDeviceTable::Handle> out;
+    PELCOD_CHECK(table.stale(out, std::chrono::seconds(10), now) == 2);
+    PELCOD_CHECK(out == std::vector<PelcoDDeviceTable::Handle>({handles[2], partial}));
+    out.clear();
+    PELCOD_CHECK(table.stale(out, std::chrono::seconds(10), now + std::chrono::seconds(11)) == table.size());
+}
+
+} // namespace
+
+int main() {
+    longIdleDevicesAreStale();
+    unknownAndMovedAxesAreStale();
+    return pelcoDTestResult("PelcoDDeviceTableTest");
+}
@@ -0,0 +1,141 @@
+#include "PelcoDTransport.hpp"
+#include "PelcoDTest.hpp"
+
+namespace {
+
+bool readFrame(int fd, PelcoDFrame& frame) {
+    std::size_t got = 0;
+    while (got < PelcoDFrame::kSize) {
+        pollfd p {fd, POLLIN, 0};
+        if (::poll(&p, 1, 2000) <= 0) {
+            return false;
+        }
+        ssize_t n = ::read(fd, frame.bytes.data() + got, PelcoDFrame::kSize - got);
+        if (n <= 0) {
+            return false;
+        }
+        got += std::size_t(n);
+    }
+    return true;
+}
+
+void respond(int fd, std::uint8_t address, PelcoDCommand cmd, std::uint16_t value) {
+    PelcoDFrame response(address, cmd, std::uint8_t(value >> 8), std::uint8_t(value));
+    PELCOD_CHECK(::write(fd, response.data(), PelcoDFrame::kSize) == ssize_t(PelcoDFrame::kSize));
+}
+
+template <typename Predicate>
+bool eventually(Predicate predicate) {
+    for (int i = 0; i < 200; ++i) {
+        if (predicate()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+// 巡检只经由设备表:查询的响应与写出的运动指令都更新缓存
+void inspectionUsesTheDeviceTable() {
+    int sv[2];
+    PELCOD_CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) == 0);
+    PelcoDFleet fleet(1);
+    PelcoDBusTiming timing;
+    timing.baudRate = 115200;
+    auto bus = fleet.addBus(sv[0], timing);
+    fleet.addCamera(1001, bus, 0x01);
+    fleet.addCamera(1002, bus, 0x02);
+    bool rejected = false;
+    try {
+        fleet.addCamera(1003, bus, 0x02);
+    } catch (const std::logic_error&) {
+        rejected = true;
+    }
+    PELCOD_CHECK(rejected);
+    fleet.start();
+
+    // 总线表在启动后只读
+    int late[2];
+    PELCOD_CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, late) == 0);
+    rejected = false;
+    try {
+        fleet.addBus(late[0]);
+    } catch (const std::logic_error&) {
+        rejected = true;
+    }
+    PELCOD_CHECK(rejected);
+    ::close(late[0]);
+    ::close(late[1]);
+
+    std::vector<PelcoDFleet::CameraId> stale;
+    PELCOD_CHECK(fleet.staleCameras(stale, std::chrono::minutes(1)) == 2);
+
+    const std::pair<PelcoDQuery, PelcoDCommand> axes[] = {
+        {PelcoDQuery::Pan, PelcoDCommand::QueryPanPositionResponse},
+        {PelcoDQuery::Tilt, PelcoDCommand::QueryTiltPositionResponse},
+        {PelcoDQuery::Zoom, PelcoDCommand::QueryZoomPositionResponse},
+    };
+    for (auto& axis : axes) {
+        fleet.query(1001, axis.first);
+        PelcoDFrame query;
+        PELCOD_CHECK(readFrame(sv[1], query));
+        PELCOD_CHECK(query.bytes[1] == 0x01 && PelcoDFrameView(query.data()).command() == pelcoDQueryCommand(axis.first));
+        respond(sv[1], 0x01, axis.second, 0x0100);
+    }
+    std::uint16_t value = 0;
+    PELCOD_CHECK(eventually([&] { return fleet.position(1001, PelcoDQuery::Zoom, value); }));
+    PELCOD_CHECK(fleet.position(1001, PelcoDQuery::Pan, value) && value == 0x0100);
+    stale.clear();
+    PELCOD_CHECK(fleet.staleCameras(stale, std::chrono::minutes(1)) == 1);
+    PELCOD_CHECK(stale == std::vector<PelcoDFleet::CameraId>({1002}));
+
+    // 经协议对象发出的运动指令让 pan 缓存失效
+    fleet.camera(1001).panLeft(0x20);
+    PelcoDFrame left;
+    PELCOD_CHECK(readFrame(sv[1], left));
+    PELCOD_CHECK(eventually([&] { return !fleet.position(1001, PelcoDQuery::Pan, value); }));
+    PELCOD_CHECK(fleet.position(1001, PelcoDQuery::Tilt, value));
+    stale.clear();
+    PELCOD_CHECK(fleet.staleCameras(stale, std::chrono::minutes(1)) == 2);
+    ::close(sv[1]);
+}
+
+// 迁移总线的同时投递任务,任务总在总线当前所属的线程中执行且不会丢失
+void postFollowsMovedBus() {
+    int sv[2];
+    PELCOD_CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) == 0);
+    PelcoDFleet fleet(2);
+    auto bus = fleet.addBus(sv[0]);
+    fleet.addCamera(1001, bus, 0x01);
+    fleet.start();
+    constexpr int kTasks = 5000;
+    std::atomic<int> ran {0};
+    std::atomic<int> foreign {0};
+    std::atomic<bool> posting {true};
+    std::thread mover([&] {
+        for (std::size_t i = 0; posting; ++i) {
+            fleet.moveBus(bus, i % 2);
+        }
+    });
+    for (int i = 0; i < kTasks; ++i) {
+        fleet.post(1001, [&](PelcoDBusProtocol& camera) {
+            if (!camera.bus().channel().reactor().inLoopThread()) {
+                ++foreign;
+            }
+            ++ran;
+        });
+    }
+    posting = false;
+    mover.join();
+    PELCOD_CHECK(eventually([&] { return ran == kTasks; }));
+    PELCOD_CHECK(foreign == 0);
+    ::close(sv[1]);
+}
+
+} // namespace
+
+int main() {
+    inspectionUsesTheDeviceTable();
+    postFollowsMovedBus();
+    return pelcoDTestResult("PelcoDFleetTest");
+}
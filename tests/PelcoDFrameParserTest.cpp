@@ -0,0 +1,131 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+void append(Bytes& stream, const PelcoDFrame& frame) {
+    stream.insert(stream.end(), frame.bytes.begin(), frame.bytes.end());
+}
+
+// 以 chunk 字节为单位切分后逐段喂给解析器,返回解析出的帧
+std::vector<PelcoDFrame> parse(PelcoDFrameParser& parser, const Bytes& stream, std::size_t chunk) {
+    std::vector<PelcoDFrame> frames;
+    for (std::size_t i = 0; i < stream.size(); i += chunk) {
+        parser.feed(stream.data() + i, std::min(chunk, stream.size() - i), [&](const PelcoDFrameView& view) {
+            PelcoDFrame frame;
+            std::copy(view.data(), view.data() + PelcoDFrame::kSize, frame.bytes.begin());
+            frames.push_back(frame);
+        });
+    }
+    return frames;
+}
+
+bool sameFrames(const std::vector<PelcoDFrame>& a, const std::vector<PelcoDFrame>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (a[i].bytes != b[i].bytes) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const PelcoDFrame kPanLeft(0x01, PelcoDCommand::Left, 0x20, 0x00);
+const PelcoDFrame kResponse(0x02, PelcoDCommand::QueryPanPositionResponse, 0x12, 0x34);
+const PelcoDFrame kStop(0x01, PelcoDCommand::Stop, 0x00, 0x00);
+
+// 干净的帧流不论怎样切分都原样解析出来,不计重新同步
+void framesSplitAcrossFeeds() {
+    Bytes stream;
+    append(stream, kPanLeft);
+    append(stream, kResponse);
+    append(stream, kStop);
+    const std::vector<PelcoDFrame> expected {kPanLeft, kResponse, kStop};
+    for (std::size_t chunk = 1; chunk <= stream.size(); ++chunk) {
+        PelcoDFrameParser parser;
+        PELCOD_CHECK(sameFrames(parse(parser, stream, chunk), expected));
+        PELCOD_CHECK(parser.stats().frames == 3);
+        PELCOD_CHECK(parser.stats().resyncs == 0 && parser.stats().discardedBytes == 0);
+    }
+}
+
+// 垃圾数据、校验失败的帧与孤立的同步字节都被丢弃,之后的帧照常解析;结果与切分方式无关
+void garbageAndBadChecksumsResync() {
+    Bytes stream {0x12, 0x34};
+    append(stream, kPanLeft);
+    auto corrupt = kPanLeft;
+    ++corrupt.bytes[6];
+    append(stream, corrupt);
+    append(stream, kResponse);
+    // 孤立的 0xff 与其后的帧拼成一个校验失败的窗口
+    stream.push_back(0xff);
+    stream.push_back(0x7f);
+    append(stream, kStop);
+    const std::vector<PelcoDFrame> expected {kPanLeft, kResponse, kStop};
+
+    for (std::size_t chunk = 1; chunk <= stream.size(); ++chunk) {
+        PelcoDFrameParser parser;
+        PELCOD_CHECK(sameFrames(parse(parser, stream, chunk), expected));
+        const auto& stats = parser.stats();
+        PELCOD_CHECK(stats.frames == 3);
+        PELCOD_CHECK(stats.badChecksums == 2);
+        // 开头的垃圾、损坏的帧、孤立的同步字节各一次
+        PELCOD_CHECK(stats.resyncs == 3);
+        PELCOD_CHECK(stats.discardedBytes == 2 + 7 + 2);
+    }
+}
+
+// 半帧留到下一次 feed,reset 清空残留与统计
+void partialFrameAndReset() {
+    PelcoDFrameParser parser;
+    Bytes head(kPanLeft.bytes.begin(), kPanLeft.bytes.begin() + 4);
+    PELCOD_CHECK(parse(parser, head, head.size()).empty());
+    parser.reset();
+    Bytes stream(kPanLeft.bytes.begin() + 4, kPanLeft.bytes.end());
+    append(stream, kStop);
+    auto frames = parse(parser, stream, stream.size());
+    // 残留的前半帧已清空,后半帧作为垃圾丢弃
+    PELCOD_CHECK(sameFrames(frames, {kStop}));
+    PELCOD_CHECK(parser.stats().frames == 1 && parser.stats().resyncs == 1 && parser.stats().discardedBytes == 3);
+}
+
+class SilentProtocol : public SimplePelcoDProtocolImpl {
+public:
+    using SimplePelcoDProtocolImpl::receiveData;
+
+protected:
+    using SimplePelcoDProtocolImpl::sendData;
+    void sendData(PelcoDByteView) override {
+    }
+};
+
+// receiveData 经同一解析器分发响应,统计由 receiveStats() 公开
+void protocolExposesParserStats() {
+    SilentProtocol protocol;
+    protocol.setAnyValue(0, std::uint8_t(0x02));
+    auto pan = protocol.asyncQuery(PelcoDQuery::Pan);
+    Bytes stream {0x00, 0x00};
+    append(stream, kResponse);
+    protocol.receiveData(PelcoDByteView(stream.data(), 5));
+    protocol.receiveData(PelcoDByteView(stream.data() + 5, stream.size() - 5));
+    PELCOD_CHECK(pan.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    PELCOD_CHECK(pan.get() == 0x1234);
+    const auto& stats = protocol.receiveStats();
+    PELCOD_CHECK(stats.frames == 1 && stats.resyncs == 1 && stats.discardedBytes == 2 && stats.badChecksums == 0);
+}
+
+} // namespace
+
+int main() {
+    framesSplitAcrossFeeds();
+    garbageAndBadChecksumsResync();
+    partialFrameAndReset();
+    protocolExposesParserStats();
+    return pelcoDTestResult("PelcoDFrameParserTest");
+}
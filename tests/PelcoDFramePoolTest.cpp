@@ -0,0 +1,131 @@
+#include "PelcoDTransport.hpp"
+#include "PelcoDTest.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// 统计全局 operator new 的调用次数,稳定运行后发帧路径上应为 0
+static std::atomic<long> gAllocations {0};
+
+void* operator new(std::size_t size) {
+    ++gAllocations;
+    if (void* p = std::malloc(size != 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+// 队列先进先出,槽位归还后被重复使用,不再向系统申请
+void queueReusesPoolSlots() {
+    PelcoDFrameQueue queue;
+    for (int i = 0; i < 512; ++i) {
+        queue.push_back(PelcoDFrame(0x01, PelcoDCommand::SetPanPosition, std::uint8_t(i >> 8), std::uint8_t(i)));
+    }
+    PELCOD_CHECK(queue.size() == 512);
+    PELCOD_CHECK(queue.find([](const PelcoDFrame& frame) { return frame.bytes[5] == 0x10; }) != nullptr);
+    for (int i = 0; i < 512; ++i) {
+        PELCOD_CHECK((queue.front().bytes[4] << 8 | queue.front().bytes[5]) == i);
+        queue.pop_front();
+    }
+    PELCOD_CHECK(queue.empty());
+
+    auto capacity = PelcoDFramePool::instance().capacity();
+    long before = gAllocations;
+    for (int round = 0; round < 1000; ++round) {
+        for (int i = 0; i < 512; ++i) {
+            queue.push_back(PelcoDFrame(0x01, PelcoDCommand::Left, 0x20, 0x00));
+        }
+        queue.clear();
+    }
+    PELCOD_CHECK(gAllocations - before == 0);
+    PELCOD_CHECK(PelcoDFramePool::instance().capacity() == capacity);
+}
+
+// 一条总线 16 台摄像机持续下发,预热之后调度、反应器与端口都不再分配内存
+void busSendPathDoesNotAllocate() {
+    constexpr int kCameras = 16;
+    PelcoDEpollReactor reactor;
+    std::thread loop([&] { reactor.run(); });
+    int sv[2];
+    PELCOD_CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) == 0);
+    {
+        PelcoDSerialPort port(reactor);
+        port.open(sv[0]);
+        PelcoDBusTiming timing;
+        timing.baudRate = 10000000;
+        timing.turnaround = std::chrono::microseconds(0);
+        PelcoDBus bus(port, timing);
+        bus.scheduler().setCoalesceMotion(false);
+        std::vector<std::unique_ptr<PelcoDBusProtocol>> cameras;
+        for (int c = 1; c <= kCameras; ++c) {
+            cameras.emplace_back(new PelcoDBusProtocol(bus, std::uint8_t(c)));
+        }
+
+        std::atomic<bool> stop {false};
+        std::atomic<long> received {0};
+        std::thread reader([&] {
+            std::uint8_t data[4096];
+            while (!stop) {
+                pollfd p {sv[1], POLLIN, 0};
+                if (::poll(&p, 1, 20) > 0) {
+                    ssize_t n = ::read(sv[1], data, sizeof(data));
+                    if (n > 0) {
+                        received += n;
+                    }
+                }
+            }
+        });
+
+        long sent = 0;
+        auto send = [&](int rounds) {
+            for (int round = 0; round < rounds; ++round) {
+                for (auto& camera : cameras) {
+                    camera->setPanPosition(std::uint16_t(round));
+                    camera->stopMotion();
+                    sent += 2;
+                }
+                while (bus.scheduler().pending() > 256) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            }
+            while (bus.scheduler().pending() > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        };
+
+        send(300);
+        long before = gAllocations;
+        send(1000);
+        long allocations = gAllocations - before;
+        if (allocations != 0) {
+            std::fprintf(stderr, "%ld allocations for %d frames\n", allocations, 2000 * kCameras);
+        }
+        PELCOD_CHECK(allocations == 0);
+
+        stop = true;
+        reader.join();
+        PELCOD_CHECK(received == sent * long(PelcoDFrame::kSize));
+        cameras.clear();
+        port.close();
+    }
+    ::close(sv[1]);
+    reactor.stop();
+    loop.join();
+}
+
+} // namespace
+
+int main() {
+    queueReusesPoolSlots();
+    busSendPathDoesNotAllocate();
+    return pelcoDTestResult("PelcoDFramePoolTest");
+}
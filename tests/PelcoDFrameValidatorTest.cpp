@@ -0,0 +1,52 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+#include <cstring>
+#include <random>
+
+namespace {
+
+// 混入坏校验和与坏同步字节,批量结果与逐帧 isValid 一致,位图的多余位为 0
+void bulkMatchesSingleFrames() {
+    std::mt19937 rng(2);
+    for (std::size_t count = 0; count < 300; ++count) {
+        std::vector<std::uint8_t> frames(count * PelcoDFrame::kSize);
+        for (std::size_t i = 0; i < count; ++i) {
+            PelcoDFrame frame(std::uint8_t(rng() % 4), std::uint8_t(rng()), std::uint8_t(rng()), std::uint8_t(rng()), std::uint8_t(rng()));
+            std::uint8_t* raw = frames.data() + i * PelcoDFrame::kSize;
+            std::memcpy(raw, frame.data(), PelcoDFrame::kSize);
+            switch (rng() % 6) {
+            case 0: raw[rng() % PelcoDFrame::kSize] ^= std::uint8_t(1u << (rng() % 8)); break;
+            case 1: raw[0] = 0xfe; break;
+            default: break;
+            }
+        }
+        std::vector<std::uint64_t> all((count + 63) / 64, ~std::uint64_t(0));
+        std::vector<std::uint64_t> filtered((count + 63) / 64, ~std::uint64_t(0));
+        std::size_t valid = PelcoDFrameValidator::validate(frames.data(), count, all.data());
+        std::size_t matched = PelcoDFrameValidator::validate(frames.data(), count, std::uint8_t(0x02), filtered.data());
+        std::size_t expectValid = 0;
+        std::size_t expectMatched = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint8_t* raw = frames.data() + i * PelcoDFrame::kSize;
+            bool ok = PelcoDFrameValidator::isValid(raw, PelcoDFrame::kSize);
+            bool match = ok && raw[1] == 0x02;
+            expectValid += ok;
+            expectMatched += match;
+            PELCOD_CHECK(bool((all[i / 64] >> (i % 64)) & 1) == ok);
+            PELCOD_CHECK(bool((filtered[i / 64] >> (i % 64)) & 1) == match);
+        }
+        for (std::size_t i = count; i < all.size() * 64; ++i) {
+            PELCOD_CHECK(!((all[i / 64] >> (i % 64)) & 1));
+        }
+        PELCOD_CHECK(valid == expectValid);
+        PELCOD_CHECK(matched == expectMatched);
+    }
+}
+
+} // namespace
+
+int main() {
+    bulkMatchesSingleFrames();
+    return pelcoDTestResult("PelcoDFrameValidatorTest");
+}
@@ -0,0 +1,62 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+namespace {
+
+using Clock = PelcoDMotionEstimator::Clock;
+
+void absoluteMovesDropTheEstimate() {
+    for (auto cmd : {PelcoDCommand::SetPanPosition, PelcoDCommand::SetTiltPosition, PelcoDCommand::CallPreset}) {
+        PelcoDMotionEstimator estimator;
+        auto now = Clock::now();
+        estimator.correct(PelcoDQuery::Pan, 1000, now);
+        estimator.correct(PelcoDQuery::Tilt, 500, now);
+        float pan = 0.f;
+        float tilt = 0.f;
+        PELCOD_CHECK(estimator.estimate(pan, tilt, now));
+        estimator.command(cmd, 0x46, 0x50, now);
+        // 目标位置不是当前位置,ptz() 应回落到真实查询
+        PELCOD_CHECK(!estimator.estimate(pan, tilt, now + std::chrono::milliseconds(10)));
+        estimator.correct(PelcoDQuery::Pan, 18000, now + std::chrono::milliseconds(20));
+        estimator.correct(PelcoDQuery::Tilt, 0, now + std::chrono::milliseconds(20));
+        PELCOD_CHECK(estimator.estimate(pan, tilt, now + std::chrono::milliseconds(30)));
+        PELCOD_CHECK(pan == 180.f && tilt == 0.f);
+    }
+}
+
+void relativeMotionKeepsEstimating() {
+    PelcoDMotionEstimator estimator(PelcoDMotionModel::linear(100.f, 60.f));
+    auto now = Clock::now();
+    estimator.correct(PelcoDQuery::Pan, 0, now);
+    estimator.correct(PelcoDQuery::Tilt, 0, now);
+    estimator.command(PelcoDCommand::Right, 0x3f, 0x00, now);
+    float pan = 0.f;
+    float tilt = 0.f;
+    PELCOD_CHECK(estimator.estimate(pan, tilt, now + std::chrono::milliseconds(100)));
+    PELCOD_CHECK(pan > 9.f && pan < 11.f);
+}
+
+// 不影响运动状态的扩展命令不改变估算,默认时间的重载与显式时间的结果一致
+void extendedCommandsKeepTheEstimate() {
+    PelcoDMotionEstimator estimator;
+    auto now = PelcoDMotionEstimator::Clock::now();
+    estimator.correct(PelcoDQuery::Pan, 9000, now);
+    estimator.correct(PelcoDQuery::Tilt, 0, now);
+    estimator.command(PelcoDCommand::SetZoomPosition, 0x12, 0x34);
+    estimator.command(PelcoDCommand::QueryPanPosition, 0x00, 0x00);
+    float pan = 0.f;
+    float tilt = 0.f;
+    PELCOD_CHECK(estimator.estimate(pan, tilt, now));
+    PELCOD_CHECK(pan == 90.f && tilt == 0.f);
+    estimator.command(PelcoDCommand::CallPreset, 0x00, 0x01);
+    PELCOD_CHECK(!estimator.estimate(pan, tilt, now));
+}
+
+} // namespace
+
+int main() {
+    absoluteMovesDropTheEstimate();
+    relativeMotionKeepsEstimating();
+    extendedCommandsKeepTheEstimate();
+    return pelcoDTestResult("PelcoDMotionEstimatorTest");
+}
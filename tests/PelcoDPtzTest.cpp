@@ -0,0 +1,125 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+#if defined(__linux__)
+    #include "PelcoDTransport.hpp"
+#endif
+
+namespace {
+
+// 发送 tilt 查询时抛出异常,其余帧记录下来
+class FailingTilt : public SimplePelcoDProtocolImpl {
+public:
+    std::size_t sent = 0;
+    using SimplePelcoDProtocolImpl::receiveData;
+
+protected:
+    using SimplePelcoDProtocolImpl::sendData;
+    void sendData(PelcoDByteView data) override {
+        if (PelcoDFrameView(data.data()).command() == PelcoDCommand::QueryTiltPosition) {
+            throw std::runtime_error("tilt send failed");
+        }
+        ++sent;
+    }
+};
+
+void ptzWithoutTransportReturnsFalse() {
+    SimplePelcoDProtocolImpl protocol;
+    bool threw = false;
+    std::tuple<bool, float, float, float> result;
+    try {
+        result = protocol.ptz();
+    } catch (...) {
+        threw = true;
+    }
+    PELCOD_CHECK(!threw);
+    PELCOD_CHECK(!threw && !std::get<0>(result));
+    PELCOD_CHECK(protocol.queryTracker().pending() == 0);
+}
+
+void gatherCompletesWhenOneSendFails() {
+    FailingTilt protocol;
+    int calls = 0;
+    bool result = true;
+    protocol.asyncQueryPTZ([&](bool ok, const PelcoDPosition&) {
+        ++calls;
+        result = ok;
+    });
+    PELCOD_CHECK(protocol.sent == 2);
+    PELCOD_CHECK(calls == 0);
+    PelcoDFrame pan(0x01, PelcoDCommand::QueryPanPositionResponse, 0x01, 0x02);
+    PelcoDFrame zoom(0x01, PelcoDCommand::QueryZoomPositionResponse, 0x03, 0x04);
+    protocol.receiveData(pan.view());
+    protocol.receiveData(zoom.view());
+    PELCOD_CHECK(calls == 1);
+    PELCOD_CHECK(!result);
+    PELCOD_CHECK(protocol.queryTracker().pending() == 0);
+}
+
+// 8 位响应接口只有低字节,不能完成查询或写入缓存,16 位响应照常生效
+void legacyResponseHooksDoNotTouchState() {
+    FailingTilt protocol;
+    auto pan = protocol.asyncQuery(PelcoDQuery::Pan);
+    bool threw = false;
+    try {
+        protocol.queryPanPositionResponse(std::uint8_t(0x34));
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    PELCOD_CHECK(threw);
+    PELCOD_CHECK(pan.wait_for(std::chrono::seconds(0)) == std::future_status::timeout);
+    PELCOD_CHECK(protocol.stateCache().stamp(PelcoDQuery::Pan) == PelcoDStateCache::Clock::time_point());
+
+    PelcoDFrame response(0x01, PelcoDCommand::QueryPanPositionResponse, 0x12, 0x34);
+    protocol.receiveData(response.view());
+    PELCOD_CHECK(pan.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    PELCOD_CHECK(pan.get() == 0x1234);
+    PELCOD_CHECK(protocol.stateCache().stamp(PelcoDQuery::Pan) != PelcoDStateCache::Clock::time_point());
+}
+
+#if defined(__linux__)
+// 事件循环线程中调用 ptz() 不能等待自己才能分发的响应
+void ptzOnLoopThreadDoesNotBlock() {
+    PelcoDEpollReactor reactor;
+    std::thread loop([&] { reactor.run(); });
+    int sv[2];
+    PELCOD_CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) == 0);
+    PelcoDSerialPort port(reactor);
+    port.open(sv[0]);
+    {
+        PelcoDSerialProtocol protocol(port);
+        protocol.queryTracker().setTimeout(std::chrono::seconds(1));
+        std::promise<std::pair<bool, std::chrono::steady_clock::duration>> done;
+        auto result = done.get_future();
+        reactor.post([&] {
+            auto start = std::chrono::steady_clock::now();
+            auto ptz = protocol.ptz();
+            done.set_value({std::get<0>(ptz), std::chrono::steady_clock::now() - start});
+        });
+        PELCOD_CHECK(result.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        auto value = result.get();
+        PELCOD_CHECK(!value.first);
+        PELCOD_CHECK(value.second < std::chrono::milliseconds(100));
+        // 查询照常发出
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::uint8_t buffer[64];
+        PELCOD_CHECK(::read(sv[1], buffer, sizeof(buffer)) == ssize_t(3 * PelcoDFrame::kSize));
+    }
+    port.close();
+    ::close(sv[1]);
+    reactor.stop();
+    loop.join();
+}
+#endif
+
+} // namespace
+
+int main() {
+    ptzWithoutTransportReturnsFalse();
+    gatherCompletesWhenOneSendFails();
+    legacyResponseHooksDoNotTouchState();
+#if defined(__linux__)
+    ptzOnLoopThreadDoesNotBlock();
+#endif
+    return pelcoDTestResult("PelcoDPtzTest");
+}
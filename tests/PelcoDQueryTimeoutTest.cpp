@@ -0,0 +1,119 @@
+#include "PelcoDTransport.hpp"
+#include "PelcoDTest.hpp"
+
+namespace {
+
+// 对端读到的字节数,不回送任何响应
+std::size_t drain(int fd) {
+    std::size_t total = 0;
+    std::uint8_t buffer[1024];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        total += std::size_t(n);
+    }
+    return total;
+}
+
+// 设备不响应:超时与重发由事件循环定时器推进,不依赖 receiveData 或 ptz()
+void expectTimeouts(SimplePelcoDProtocolImpl& protocol, int peer, const char* name) {
+    protocol.queryTracker().setTimeout(std::chrono::milliseconds(20));
+    protocol.queryTracker().setRetries(1);
+    auto pan = protocol.asyncQuery(PelcoDQuery::Pan);
+    std::promise<bool> gathered;
+    auto ptz = gathered.get_future();
+    protocol.asyncQueryPTZ([&gathered](bool ok, const PelcoDPosition&) { gathered.set_value(ok); });
+
+    bool panReady = pan.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+    bool ptzReady = ptz.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+    PELCOD_CHECK(panReady);
+    PELCOD_CHECK(ptzReady);
+    if (panReady) {
+        bool timedOut = false;
+        try {
+            pan.get();
+        } catch (const std::runtime_error&) {
+            timedOut = true;
+        }
+        PELCOD_CHECK(timedOut);
+    }
+    if (ptzReady) {
+        PELCOD_CHECK(!ptz.get());
+    }
+    // pan 与 asyncQueryPTZ 的 pan 合并为一次查询;每个查询发出一次并重发一次
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::size_t frames = drain(peer) / PelcoDFrame::kSize;
+    if (frames != 6) {
+        std::printf("%s: peer saw %zu frames\n", name, frames);
+    }
+    PELCOD_CHECK(frames == 6);
+    PELCOD_CHECK(protocol.queryTracker().pending() == 0);
+}
+
+void serialTimesOut(PelcoDReactor& reactor) {
+    int sv[2];
+    PELCOD_CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) == 0);
+    PelcoDSerialPort port(reactor);
+    port.open(sv[0]);
+    {
+        PelcoDSerialProtocol protocol(port);
+        expectTimeouts(protocol, sv[1], "serial");
+    }
+    port.close();
+    ::close(sv[1]);
+}
+
+void tcpTimesOut(PelcoDReactor& reactor) {
+    int listener = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    PELCOD_CHECK(::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    PELCOD_CHECK(::listen(listener, 1) == 0);
+    PELCOD_CHECK(::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) == 0);
+
+    PelcoDTcpChannel channel(reactor, "127.0.0.1", ntohs(address.sin_port));
+    channel.open();
+    int peer = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    PELCOD_CHECK(peer >= 0);
+    for (int i = 0; i < 200 && !channel.isConnected(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    {
+        PelcoDTcpProtocol protocol(channel);
+        expectTimeouts(protocol, peer, "tcp");
+    }
+    channel.shutdown();
+    ::close(peer);
+    ::close(listener);
+}
+
+void busTimesOut(PelcoDReactor& reactor) {
+    int sv[2];
+    PELCOD_CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) == 0);
+    PelcoDSerialPort port(reactor);
+    port.open(sv[0]);
+    {
+        PelcoDBusTiming timing;
+        timing.baudRate = 115200;
+        timing.turnaround = std::chrono::microseconds(0);
+        PelcoDBus bus(port, timing);
+        PelcoDBusProtocol protocol(bus, 0x01);
+        expectTimeouts(protocol, sv[1], "bus");
+    }
+    port.close();
+    ::close(sv[1]);
+}
+
+} // namespace
+
+int main() {
+    PelcoDEpollReactor reactor;
+    std::thread loop([&] { reactor.run(); });
+    serialTimesOut(reactor);
+    tcpTimesOut(reactor);
+    busTimesOut(reactor);
+    reactor.stop();
+    loop.join();
+    return pelcoDTestResult("PelcoDQueryTimeoutTest");
+}
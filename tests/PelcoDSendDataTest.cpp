@@ -0,0 +1,80 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+#include <cstddef>
+
+namespace {
+
+// 只重载旧的 sendData(const std::vector&) 的子类
+class LegacyProtocol : public SimplePelcoDProtocolImpl {
+public:
+    std::vector<std::vector<std::uint8_t>> sent;
+
+protected:
+    using SimplePelcoDProtocolImpl::sendData;
+    void sendData(const std::vector<std::uint8_t>& data) override {
+        sent.push_back(data);
+    }
+};
+
+// 只重载视图版本的子类
+class ViewProtocol : public SimplePelcoDProtocolImpl {
+public:
+    std::vector<std::vector<std::uint8_t>> sent;
+
+protected:
+    using SimplePelcoDProtocolImpl::sendData;
+    void sendData(PelcoDByteView data) override {
+        sent.emplace_back(data.begin(), data.end());
+    }
+};
+
+const std::vector<std::uint8_t> kPanLeft {0xff, 0x01, 0x00, 0x04, 0x20, 0x00, 0x25};
+
+void legacySubclassReceivesEveryPath() {
+    LegacyProtocol legacy;
+    legacy.setAnyValue(0, std::uint8_t(0x01));
+    legacy.panLeft(0x20);
+    PELCOD_CHECK(legacy.sent.size() == 1);
+    PELCOD_CHECK(!legacy.sent.empty() && legacy.sent.back() == kPanLeft);
+
+    legacy.sendRawCmd(kPanLeft);
+    legacy.sendRawCmd(PelcoDByteView(kPanLeft));
+    legacy.sendRawCmd(std::vector<std::uint8_t>(kPanLeft));
+    std::byte bytes[7];
+    std::memcpy(bytes, kPanLeft.data(), sizeof(bytes));
+    legacy.sendRawCmd(PelcoDByteView(bytes, sizeof(bytes)));
+    PELCOD_CHECK(legacy.sent.size() == 5);
+    for (const auto& frame : legacy.sent) {
+        PELCOD_CHECK(frame == kPanLeft);
+    }
+}
+
+void viewSubclassReceivesMovedBuffers() {
+    ViewProtocol view;
+    view.sendRawCmd(std::vector<std::uint8_t>(kPanLeft));
+    view.sendRawCmd({0xff, 0x01, 0x00, 0x04, 0x20, 0x00, 0x25});
+    PELCOD_CHECK(view.sent.size() == 2);
+    for (const auto& frame : view.sent) {
+        PELCOD_CHECK(frame == kPanLeft);
+    }
+}
+
+void decoratorForwardsEveryOverload() {
+    LegacyProtocol legacy;
+    SimplePelcoDDecorator decorator(&legacy);
+    SimplePelcoDProtocol& protocol = decorator;
+    protocol.sendRawCmd(kPanLeft);
+    protocol.sendRawCmd(PelcoDByteView(kPanLeft));
+    protocol.sendRawCmd(std::vector<std::uint8_t>(kPanLeft));
+    PELCOD_CHECK(legacy.sent.size() == 3);
+}
+
+} // namespace
+
+int main() {
+    legacySubclassReceivesEveryPath();
+    viewSubclassReceivesMovedBuffers();
+    decoratorForwardsEveryOverload();
+    return pelcoDTestResult("PelcoDSendDataTest");
+}
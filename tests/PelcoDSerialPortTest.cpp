@@ -0,0 +1,62 @@
+#include "PelcoDTransport.hpp"
+#include "PelcoDTest.hpp"
+
+#include <atomic>
+
+namespace {
+
+// 伪终端的从端充当串口,主端充当总线上的设备
+void idlePortStaysOpen(PelcoDReactorBackend backend) {
+    int master = ::posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    PELCOD_CHECK(master >= 0 && ::grantpt(master) == 0 && ::unlockpt(master) == 0);
+    auto owned = makePelcoDReactor(backend);
+    PelcoDReactor& reactor = *owned;
+    std::thread loop([&] { reactor.run(); });
+    {
+        PelcoDSerialPort port(reactor, ::ptsname(master), {9600});
+        std::atomic<std::size_t> received {0};
+        port.setReceiver([&](PelcoDByteView data) { received += data.size(); });
+        port.open();
+
+        const PelcoDFrame response(0x01, PelcoDCommand::QueryPanPositionResponse, 0x12, 0x34);
+        for (int round = 1; round <= 3; ++round) {
+            PELCOD_CHECK(::write(master, response.data(), PelcoDFrame::kSize) == ssize_t(PelcoDFrame::kSize));
+            for (int i = 0; i < 200 && received < std::size_t(round) * PelcoDFrame::kSize; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            PELCOD_CHECK(received == std::size_t(round) * PelcoDFrame::kSize);
+            // 读空之后空闲一段时间,串口不应把没有数据当作挂断
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            PELCOD_CHECK(port.isOpen());
+        }
+
+        const PelcoDFrame stop(0x01, PelcoDCommand::Stop);
+        port.write(stop.view());
+        PelcoDFrame echoed;
+        std::size_t got = 0;
+        while (got < PelcoDFrame::kSize) {
+            pollfd p {master, POLLIN, 0};
+            if (::poll(&p, 1, 2000) <= 0) {
+                break;
+            }
+            ssize_t n = ::read(master, echoed.bytes.data() + got, PelcoDFrame::kSize - got);
+            if (n <= 0) {
+                break;
+            }
+            got += std::size_t(n);
+        }
+        PELCOD_CHECK(got == PelcoDFrame::kSize && echoed.bytes == stop.bytes);
+        port.close();
+    }
+    ::close(master);
+    reactor.stop();
+    loop.join();
+}
+
+} // namespace
+
+int main() {
+    idlePortStaysOpen(PelcoDReactorBackend::Epoll);
+    idlePortStaysOpen(PelcoDReactorBackend::IoUring);
+    return pelcoDTestResult("PelcoDSerialPortTest");
+}
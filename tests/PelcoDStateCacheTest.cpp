@@ -0,0 +1,41 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+namespace {
+
+using Clock = PelcoDStateCache::Clock;
+
+// 按掩码失效只清除指定的轴,重复失效不影响其他轴
+void invalidateClearsMaskedAxes() {
+    PelcoDStateCache cache;
+    auto now = Clock::now();
+    cache.update(PelcoDQuery::Pan, 100, now);
+    cache.update(PelcoDQuery::Tilt, 200, now);
+    cache.update(PelcoDQuery::Zoom, 300, now);
+    PelcoDPosition position;
+    PELCOD_CHECK(cache.fresh(position, now));
+
+    for (int i = 0; i < 2; ++i) {
+        cache.invalidate(pelcoDMovedAxes(PelcoDCommand::Left | PelcoDCommand::Up));
+        PELCOD_CHECK(cache.stamp(PelcoDQuery::Pan) == Clock::time_point());
+        PELCOD_CHECK(cache.stamp(PelcoDQuery::Tilt) == Clock::time_point());
+        PELCOD_CHECK(cache.stamp(PelcoDQuery::Zoom) == now);
+        PELCOD_CHECK(!cache.fresh(position, now));
+        PELCOD_CHECK(position.pan == 0 && position.tilt == 0 && position.zoom == 300);
+    }
+
+    cache.invalidate(PelcoDQuery::Zoom);
+    cache.invalidate(PelcoDQuery::Magnification);
+    Clock::time_point oldest;
+    cache.get(position, oldest);
+    PELCOD_CHECK(oldest == Clock::time_point() && position.zoom == 0);
+    cache.update(PelcoDQuery::Zoom, 7, now);
+    PELCOD_CHECK(cache.stamp(PelcoDQuery::Zoom) == now);
+}
+
+} // namespace
+
+int main() {
+    invalidateClearsMaskedAxes();
+    return pelcoDTestResult("PelcoDStateCacheTest");
+}
@@ -0,0 +1,178 @@
+#include "PelcoDTransport.hpp"
+#include "PelcoDTest.hpp"
+
+namespace {
+
+// 本机回环上的串口服务器替身
+class LoopbackServer {
+public:
+    LoopbackServer() {
+        mFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int on = 1;
+        ::setsockopt(mFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        PELCOD_CHECK(::bind(mFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+        PELCOD_CHECK(::listen(mFd, 1024) == 0);
+        socklen_t length = sizeof(address);
+        ::getsockname(mFd, reinterpret_cast<sockaddr*>(&address), &length);
+        mPort = ntohs(address.sin_port);
+    }
+    ~LoopbackServer() {
+        ::close(mFd);
+    }
+    std::uint16_t port() const {
+        return mPort;
+    }
+    // 超时返回 -1
+    int accept() {
+        pollfd p {mFd, POLLIN, 0};
+        if (::poll(&p, 1, 2000) <= 0) {
+            return -1;
+        }
+        return ::accept4(mFd, nullptr, nullptr, SOCK_CLOEXEC);
+    }
+
+private:
+    int mFd = -1;
+    std::uint16_t mPort = 0;
+};
+
+class LoopbackConfig : public ExampleAttachObject {
+public:
+    explicit LoopbackConfig(std::uint16_t port)
+        : mPort(port) {
+    }
+    virtual std::string ip() const override {
+        return "127.0.0.1";
+    }
+    virtual uint32_t port() const override {
+        return mPort;
+    }
+
+private:
+    std::uint16_t mPort;
+};
+
+template <typename Predicate>
+bool eventually(Predicate predicate) {
+    for (int i = 0; i < 400; ++i) {
+        if (predicate()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+// 读到 size 字节或超时,返回读取次数,超时返回 -1
+int readExactly(int fd, std::uint8_t* data, std::size_t size) {
+    int reads = 0;
+    std::size_t got = 0;
+    while (got < size) {
+        pollfd p {fd, POLLIN, 0};
+        if (::poll(&p, 1, 2000) <= 0) {
+            return -1;
+        }
+        ssize_t n = ::read(fd, data + got, size - got);
+        if (n <= 0) {
+            return -1;
+        }
+        got += std::size_t(n);
+        ++reads;
+    }
+    return reads;
+}
+
+// 同一轮事件循环中写出的帧合并为一次 send,对端断开后在后台重连
+void coalescesAndReconnects(PelcoDReactorBackend backend) {
+    auto owned = makePelcoDReactor(backend);
+    PelcoDReactor& reactor = *owned;
+    std::thread loop([&] { reactor.run(); });
+    LoopbackServer server;
+    {
+        PelcoDTcpProtocol ptz(reactor);
+        ptz.updateConfig(std::any(std::shared_ptr<PelcoDProtocolConfig>(std::make_shared<LoopbackConfig>(server.port()))));
+        ptz.connect();
+        int peer = server.accept();
+        PELCOD_CHECK(peer >= 0);
+        PELCOD_CHECK(eventually([&] { return ptz.isConnected(); }));
+
+        std::promise<void> queued;
+        reactor.post([&] {
+            for (int i = 0; i < 64; ++i) {
+                ptz.panLeft(std::uint8_t(i & 0x3f));
+            }
+            queued.set_value();
+        });
+        queued.get_future().wait();
+        std::uint8_t buffer[64 * PelcoDFrame::kSize];
+        PELCOD_CHECK(readExactly(peer, buffer, sizeof(buffer)) == 1);
+        PELCOD_CHECK(PelcoDFrameValidator::validate(buffer, 64) == 64);
+
+        ::close(peer);
+        peer = server.accept();
+        PELCOD_CHECK(peer >= 0);
+        PELCOD_CHECK(eventually([&] { return ptz.isConnected() && ptz.channel().connects() >= 2; }));
+
+        // 重连后查询仍经由同一连接应答
+        auto tilt = ptz.asyncQuery(PelcoDQuery::Tilt);
+        PelcoDFrame query;
+        PELCOD_CHECK(readExactly(peer, query.bytes.data(), PelcoDFrame::kSize) > 0);
+        PELCOD_CHECK(PelcoDFrameView(query.data()).command() == PelcoDCommand::QueryTiltPosition);
+        PelcoDFrame response(0x01, PelcoDCommand::QueryTiltPositionResponse, 0x01, 0x02);
+        PELCOD_CHECK(::write(peer, response.data(), PelcoDFrame::kSize) == ssize_t(PelcoDFrame::kSize));
+        PELCOD_CHECK(tilt.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+        PELCOD_CHECK(tilt.get() == 0x0102);
+        ptz.disconnect();
+        ::close(peer);
+    }
+    reactor.stop();
+    loop.join();
+}
+
+// 一个事件循环服务大量转换器连接
+void oneLoopServesManyConnections(PelcoDReactorBackend backend) {
+    auto owned = makePelcoDReactor(backend);
+    PelcoDReactor& reactor = *owned;
+    std::thread loop([&] { reactor.run(); });
+    LoopbackServer server;
+    constexpr std::size_t kConnections = 256;
+    std::vector<std::unique_ptr<PelcoDTcpChannel>> channels;
+    std::vector<int> peers;
+    for (std::size_t i = 0; i < kConnections; ++i) {
+        channels.push_back(std::make_unique<PelcoDTcpChannel>(reactor, "127.0.0.1", server.port()));
+        channels.back()->open();
+        peers.push_back(server.accept());
+    }
+    PELCOD_CHECK(eventually([&] {
+        return std::all_of(channels.begin(), channels.end(), [](const std::unique_ptr<PelcoDTcpChannel>& channel) { return channel->isConnected(); });
+    }));
+    const PelcoDFrame stop(0x01, PelcoDCommand::Stop);
+    for (auto& channel : channels) {
+        channel->write(stop.view());
+    }
+    std::size_t received = 0;
+    for (int peer : peers) {
+        PelcoDFrame frame;
+        received += peer >= 0 && readExactly(peer, frame.bytes.data(), PelcoDFrame::kSize) > 0 && frame.bytes == stop.bytes;
+    }
+    PELCOD_CHECK(received == kConnections);
+    channels.clear();
+    for (int peer : peers) {
+        ::close(peer);
+    }
+    reactor.stop();
+    loop.join();
+}
+
+} // namespace
+
+int main() {
+    for (auto backend : {PelcoDReactorBackend::Epoll, PelcoDReactorBackend::IoUring}) {
+        coalescesAndReconnects(backend);
+        oneLoopServesManyConnections(backend);
+    }
+    return pelcoDTestResult("PelcoDTcpChannelTest");
+}
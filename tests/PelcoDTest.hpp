@@ -0,0 +1,32 @@
+#ifndef PELCODTEST_HPP
+#define PELCODTEST_HPP
+
+#include <cstdio>
+
+/*!
+ * 测试用的最小断言,不依赖测试框架.
+ * 失败时打印位置并继续执行,main 返回 pelcoDTestResult() 交给 ctest 判定.
+ */
+inline int& pelcoDTestFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define PELCOD_CHECK(expr)                                                                   \
+    do {                                                                                     \
+        if (!(expr)) {                                                                       \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);             \
+            ++pelcoDTestFailures();                                                          \
+        }                                                                                    \
+    } while (0)
+
+inline int pelcoDTestResult(const char* name) {
+    if (pelcoDTestFailures() != 0) {
+        std::printf("%s: %d check(s) failed\n", name, pelcoDTestFailures());
+        return 1;
+    }
+    std::printf("%s: ok\n", name);
+    return 0;
+}
+
+#endif // PELCODTEST_HPP
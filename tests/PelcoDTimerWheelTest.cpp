@@ -0,0 +1,56 @@
+#include "PelcoDProtocol.hpp"
+#include "PelcoDTest.hpp"
+
+#include <atomic>
+#include <future>
+
+namespace {
+
+using Clock = PelcoDTimerWheel::Clock;
+
+// 空闲多圈之后登记的定时器仍按时触发,且不早于登记的时刻
+void firesOnTimeAfterIdle() {
+    PelcoDTimerWheel wheel(std::chrono::microseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    for (int i = 0; i < 3; ++i) {
+        std::promise<Clock::time_point> fired;
+        auto when = Clock::now() + std::chrono::milliseconds(2);
+        wheel.schedule(when, [&] { fired.set_value(Clock::now()); });
+        auto future = fired.get_future();
+        PELCOD_CHECK(future.wait_for(std::chrono::seconds(1)) == std::future_status::ready);
+        auto at = future.get();
+        PELCOD_CHECK(at >= when);
+        PELCOD_CHECK(at - when < std::chrono::milliseconds(50));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+// 空闲后登记已过期的时刻立即执行,顺序与到期时刻一致
+void pastDeadlinesRunInOrder() {
+    PelcoDTimerWheel wheel(std::chrono::microseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::mutex mutex;
+    std::vector<int> order;
+    std::promise<void> done;
+    auto now = Clock::now();
+    wheel.schedule(now + std::chrono::milliseconds(5), [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(2);
+        done.set_value();
+    });
+    wheel.schedule(now - std::chrono::milliseconds(20), [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(1);
+    });
+    PELCOD_CHECK(done.get_future().wait_for(std::chrono::seconds(1)) == std::future_status::ready);
+    std::lock_guard<std::mutex> lock(mutex);
+    PELCOD_CHECK(order == std::vector<int>({1, 2}));
+}
+
+} // namespace
+
+int main() {
+    firesOnTimeAfterIdle();
+    pastDeadlinesRunInOrder();
+    return pelcoDTestResult("PelcoDTimerWheelTest");
+}